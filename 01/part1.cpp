@@ -5,6 +5,9 @@
 #include <assert.h>
 #include <algorithm>
 #include <utility>
+#include <cstdint>
+
+#include "../scanner.h"
 
 /// @brief Iterate through the file and split each line into two integers separated by a space
 /// Store each integer in a vector for each column, and return as a pair of vectors.
@@ -12,40 +15,76 @@
 /// @return A pair object containing vectors of the two columns.
 std::pair<std::vector<int>, std::vector<int>> splitAndParseFile(const std::string &input)
 {
-	std::vector<int> list1, list2;
-	std::ifstream file(input);
-	if (!file.is_open())
-	{
-		return {{}, {}};
-	}
+	ScanSequence ss(input, true);
+	std::vector<std::vector<int>> columns = ss.scanIntColumns(2);
 
-	std::string line;
-	int a, b;
-	while (std::getline(file, line))
+	return {std::move(columns[0]), std::move(columns[1])};
+}
+
+/// @brief Sort a list with an LSD radix sort on the offset of each value from the list minimum, 11 bits per pass.
+/// Only as many passes are made as the observed range of values needs.
+/// @param values The list to sort in place
+/// @param min_value The smallest value in the list
+/// @param max_value The largest value in the list
+void radixSort(std::vector<int> &values, int min_value, int max_value)
+{
+	const int RADIX_BITS = 11;
+	const uint32_t RADIX_MASK = (1u << RADIX_BITS) - 1;
+
+	uint32_t range = uint32_t(int64_t(max_value) - min_value);
+	std::vector<int> scratch(values.size());
+	for (int shift = 0; shift < 32 && (range >> shift); shift += RADIX_BITS)
 	{
-		size_t first_space = line.find_first_of(' ');
-		size_t last_space = line.find_last_of(' ');
+		// Count each digit, then turn the counts into the starting position of each digit
+		std::vector<size_t> offsets(RADIX_MASK + 1, 0);
+		for (auto x : values)
+		{
+			offsets[(uint32_t(int64_t(x) - min_value) >> shift) & RADIX_MASK]++;
+		}
+		size_t total = 0;
+		for (auto &o : offsets)
+		{
+			size_t count = o;
+			o = total;
+			total += count;
+		}
 
-		list1.push_back(std::stoi(line.substr(0, first_space)));
-		list2.push_back(std::stoi(line.substr(last_space + 1)));
+		for (auto x : values)
+		{
+			scratch[offsets[(uint32_t(int64_t(x) - min_value) >> shift) & RADIX_MASK]++] = x;
+		}
+		values.swap(scratch);
 	}
+}
 
-	file.close();
+/// @brief Sort a list, choosing the algorithm from the list size and range of values.
+/// Short lists use std::sort, everything else uses radixSort.
+/// @param values The list to sort in place
+void sortList(std::vector<int> &values)
+{
+	const size_t MIN_RADIX_SIZE = 256;
+	if (values.size() < MIN_RADIX_SIZE)
+	{
+		std::sort(values.begin(), values.end());
+		return;
+	}
 
-	return {list1, list2};
+	auto [min_it, max_it] = std::minmax_element(values.begin(), values.end());
+	radixSort(values, *min_it, *max_it);
 }
 
 /// @brief Sum the absolute distance between each pair of values in the given lists
 /// @param a The first list of integer values
 /// @param b The second list of integer values. Must be the same length as a
-/// @return An integer value representing the distance between the two lists.
-int calcDistanceBetweenSortedLists(const std::vector<int> &a, const std::vector<int> &b)
+/// @return An integer value representing the distance between the two lists. Each difference and the sum are
+/// 64 bit, so neither overflows however far apart or however long the lists are.
+int64_t calcDistanceBetweenSortedLists(const std::vector<int> &a, const std::vector<int> &b)
 {
-	int dist = 0;
+	int64_t dist = 0;
 	assert(a.size() == b.size());
-	for (int i = 0; i < a.size(); i++)
+	for (size_t i = 0; i < a.size(); i++)
 	{
-		dist += std::abs(a[i] - b[i]);
+		dist += std::abs(int64_t(a[i]) - b[i]);
 	}
 	return dist;
 }
@@ -55,10 +94,10 @@ int main()
 	std::string input = "input.txt";
 	std::pair<std::vector<int>, std::vector<int>> lists = splitAndParseFile(input);
 
-	std::sort(lists.first.begin(), lists.first.end());
-	std::sort(lists.second.begin(), lists.second.end());
+	sortList(lists.first);
+	sortList(lists.second);
 
-	int dist = calcDistanceBetweenSortedLists(lists.first, lists.second);
+	int64_t dist = calcDistanceBetweenSortedLists(lists.first, lists.second);
 	std::cout << "Distance between lists: " << dist << std::endl;
 
 	return 0;
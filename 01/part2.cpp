@@ -6,6 +6,9 @@
 #include <algorithm>
 #include <utility>
 #include <unordered_map>
+#include <cstdint>
+
+#include "../scanner.h"
 
 /// @brief Iterate through the file and split each line into two integers separated by a space
 /// Store each integer in a vector for each column, and return as a pair of vectors.
@@ -13,50 +16,114 @@
 /// @return A pair object containing vectors of the two columns.
 std::pair<std::vector<int>, std::vector<int>> splitAndParseFile(const std::string &input)
 {
-	std::pair<std::vector<int>, std::vector<int>> lists;
-	std::ifstream file(input);
-	if (!file.is_open())
-	{
-		return {{}, {}};
-	}
-
-	std::string line;
-	int a, b;
-	while (std::getline(file, line))
-	{
-		size_t first_space = line.find_first_of(' ');
-		size_t last_space = line.find_last_of(' ');
+	ScanSequence ss(input, true);
+	std::vector<std::vector<int>> columns = ss.scanIntColumns(2);
 
-		lists.first.push_back(std::stoi(line.substr(0, first_space)));
-		lists.second.push_back(std::stoi(line.substr(last_space + 1)));
-	}
-
-	file.close();
-
-	return lists;
+	return {std::move(columns[0]), std::move(columns[1])};
 }
 
 /// @brief Calculate the 'distance' between sorted lists. This 'distance' value is calculated
 /// by summing all the values of a[i] multiplied the number of occurances of a[i] in list b
+/// Occurances are counted in a flat array over the range of values in b when that range is small enough,
+/// and in a hash map otherwise. Each thread counts its own slice of b before the counts are merged, and
+/// then each thread sums its own slice of a. The sum is exact, so the result doesn't depend on the thread count.
 /// @param a Main vector of values
 /// @param b Vector of values where each value occurs >= 1 times.
+/// @param threads The number of threads to use. Defaults to the hardware concurrency, and small lists use fewer threads.
 /// @return the 'distance' sum
-int calcDistanceBetweenSortedLists(const std::vector<int> &a, const std::vector<int> &b)
+int64_t calcDistanceBetweenSortedLists(const std::vector<int> &a, const std::vector<int> &b, unsigned threads = 0)
 {
-	// build an hash map for the second list
-	// the map contains <value> : <occurances>
-	std::unordered_map<int, int> reps;
-	for (auto x : b)
+	// Widest range of values in b that gets a counting array
+	const int64_t MAX_COUNTING_RANGE = 1 << 24;
+	// Most counting array entries to hold across all threads at once
+	const int64_t MAX_COUNTING_ENTRIES = 1 << 26;
+	const size_t MIN_VALUES_PER_THREAD = 1 << 16; // list values
+
+	if (b.empty())
+		return 0;
+
+	unsigned a_threads = threadCount(a.size(), MIN_VALUES_PER_THREAD, threads);
+	unsigned b_threads = threadCount(b.size(), MIN_VALUES_PER_THREAD, threads);
+
+	auto [min_it, max_it] = std::minmax_element(b.begin(), b.end());
+	int64_t min_value = *min_it;
+	int64_t range = int64_t(*max_it) - min_value + 1;
+
+	std::vector<int64_t> partial_dist(a_threads, 0);
+	if (range <= MAX_COUNTING_RANGE)
 	{
-		reps[x]++;
-	}
+		// Each thread's array contains reps[<value> - min_value] = <occurances>
+		b_threads = std::max<int64_t>(1, std::min<int64_t>(b_threads, MAX_COUNTING_ENTRIES / range));
+		std::vector<std::vector<int64_t>> local_reps(b_threads);
+		parallelRanges(b.size(), b_threads, [&](unsigned t, size_t begin, size_t end)
+					   {
+			local_reps[t].assign(range, 0);
+			for (size_t i = begin; i < end; i++)
+			{
+				local_reps[t][b[i] - min_value]++;
+			} });
 
-	int dist = 0;
-	for (auto x : a)
+		// Merge into the first thread's array, each thread taking a slice of the value range
+		std::vector<int64_t> &reps = local_reps[0];
+		parallelRanges(range, b_threads, [&](unsigned, size_t begin, size_t end)
+					   {
+			for (size_t t = 1; t < local_reps.size(); t++)
+			{
+				for (size_t v = begin; v < end; v++)
+				{
+					reps[v] += local_reps[t][v];
+				}
+			} });
+
+		parallelRanges(a.size(), a_threads, [&](unsigned t, size_t begin, size_t end)
+					   {
+			int64_t dist = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				int64_t idx = a[i] - min_value;
+				if (idx >= 0 && idx < range)
+					dist += a[i] * reps[idx];
+			}
+			partial_dist[t] = dist; });
+	}
+	else
 	{
-		dist += x * reps[x];
+		// build an hash map for each thread's slice of the second list, then merge them
+		// the map contains <value> : <occurances>
+		std::vector<std::unordered_map<int, int64_t>> local_reps(b_threads);
+		parallelRanges(b.size(), b_threads, [&](unsigned t, size_t begin, size_t end)
+					   {
+			for (size_t i = begin; i < end; i++)
+			{
+				local_reps[t][b[i]]++;
+			} });
+
+		std::unordered_map<int, int64_t> &reps = local_reps[0];
+		for (size_t t = 1; t < local_reps.size(); t++)
+		{
+			for (auto [value, count] : local_reps[t])
+			{
+				reps[value] += count;
+			}
+		}
+
+		parallelRanges(a.size(), a_threads, [&](unsigned t, size_t begin, size_t end)
+					   {
+			int64_t dist = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				auto it = reps.find(a[i]);
+				if (it != reps.end())
+					dist += a[i] * it->second;
+			}
+			partial_dist[t] = dist; });
 	}
 
+	int64_t dist = 0;
+	for (auto d : partial_dist)
+	{
+		dist += d;
+	}
 	return dist;
 }
 
@@ -65,7 +132,7 @@ int main()
 	std::string input = "input.txt";
 	std::pair<std::vector<int>, std::vector<int>> lists = splitAndParseFile(input);
 
-	int dist = calcDistanceBetweenSortedLists(lists.first, lists.second);
+	int64_t dist = calcDistanceBetweenSortedLists(lists.first, lists.second);
 
 	std::cout << "Distance between lists: " << dist << std::endl;
 
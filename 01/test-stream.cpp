@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+
+#include "../scanner.h"
+
+using namespace std;
+
+// Checks StreamScanSequence against ScanSequence with block sizes small enough that tokens
+// span block boundaries. Prints one line per check, and exits non zero if any of them fail.
+// Build with: g++ -std=c++17 -O2 test-stream.cpp -o test-stream
+
+const size_t BLOCK_SIZES[] = {1, 2, 3, 5, 7, 64, 1 << 16};
+
+int failures = 0;
+
+void check(bool ok, const string &what, size_t blockSize)
+{
+	cout << (ok ? "ok   " : "FAIL ") << what << " (block size " << blockSize << ")" << endl;
+	failures += !ok;
+}
+
+// Parse the day 01 lists through a stream, and compare them to the lists from a ScanSequence
+void checkLists(const string &input)
+{
+	ScanSequence whole(input, true);
+	vector<vector<int>> expected = whole.scanIntColumns(2);
+
+	for (size_t blockSize : BLOCK_SIZES)
+	{
+		ifstream file(input);
+		StreamScanSequence ss(file, blockSize);
+		vector<vector<int>> lists(2);
+		ss.applyWithDelim('\n', [&](StreamScanSequence &line)
+						  {
+			lists[0].push_back(line.scanInt());
+			lists[1].push_back(line.scanInt()); });
+		check(lists == expected, "day 01 lists match ScanSequence", blockSize);
+	}
+}
+
+// Scan every kind of token across block boundaries, and read past the end of the stream
+void checkTokens()
+{
+	const string text = "word=-1234567,tail;18446744073709551615 xyz\nlast";
+	for (size_t blockSize : BLOCK_SIZES)
+	{
+		istringstream stream(text);
+		StreamScanSequence ss(stream, blockSize);
+
+		bool ok = ss.scanString('=') == "word";
+		ok &= ss.consumeString('=');
+		ok &= ss.scanInt() == -1234567;
+		ok &= ss.consumeString(",tail;");
+		ok &= ss.scanUInt() == 4294967295u; // wraps, as the value is past 32 bits
+		ss.skipUntilPast('\n');
+		ok &= ss.peekAtChar() == 'l';
+		ok &= ss.scanString('\n') == "last";
+		check(ok, "tokens across block boundaries", blockSize);
+
+		bool atEnd = ss.isAtEnd() && ss.peekAtChar() == '\0' && ss.scanChar() == '\0' && !ss.consumeString('x');
+		check(atEnd, "reads past the end of the stream give '\\0'", blockSize);
+	}
+}
+
+int main()
+{
+	checkLists("input.txt");
+	checkTokens();
+	return failures ? 1 : 0;
+}
@@ -4,77 +4,223 @@
 #include <fstream>
 #include <sstream>
 
-typedef std::vector<int> Report;
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-int sign(int i)
+#include "../scanner.h"
+
+/// @brief A view of one report's levels inside a ReportList
+struct Report
 {
-	if (i == 0)
-		return 0;
-	if (i < 0)
-		return -1;
-	return 1;
-}
+	const int *first;
+	const int *last;
+
+	size_t size() const { return last - first; }
+	const int &operator[](size_t i) const { return first[i]; }
+	const int *begin() const { return first; }
+	const int *end() const { return last; }
+};
+
+/// @brief Every report stored back to back in one flat array of levels.
+/// Report i is levels[offsets[i]] up to levels[offsets[i + 1]].
+struct ReportList
+{
+	std::vector<int> levels;
+	std::vector<size_t> offsets{0};
+
+	size_t size() const { return offsets.size() - 1; }
+	Report operator[](size_t i) const { return {levels.data() + offsets[i], levels.data() + offsets[i + 1]}; }
+};
 
-Report splitStringToReport(const std::string &line)
+/// @brief Parse every line of space separated levels in a chunk into a ReportList. Empty lines are skipped,
+/// as are tokens that aren't levels.
+/// @param chunk a sequence over whole lines of the input
+/// @return the reports in the chunk
+ReportList parseReportChunk(ScanSequence &chunk)
 {
-	std::string tmp;
-	std::stringstream ss(line);
-	Report report;
-	while (std::getline(ss, tmp, ' '))
+	ReportList reports;
+	while (!chunk.isAtEnd())
 	{
-		report.push_back(std::stoi(tmp));
+		while (chunk.consumeString(' '))
+			;
+		// A '\r' ends the line as well, for CRLF line endings
+		while (!chunk.isAtEnd() && chunk.peekAtChar() != '\n' && chunk.peekAtChar() != '\r')
+		{
+			int level;
+			if (chunk.scanIntChecked(level))
+			{
+				reports.levels.push_back(level);
+			}
+			else
+			{
+				// Skip the rest of a token that isn't a level
+				while (!chunk.isAtEnd() && chunk.peekAtChar() != ' ' && chunk.peekAtChar() != '\n' && chunk.peekAtChar() != '\r')
+					chunk.scanChar();
+			}
+			while (chunk.consumeString(' '))
+				;
+		}
+		chunk.consumeString('\r');
+		chunk.consumeString('\n');
+
+		if (reports.levels.size() != reports.offsets.back())
+			reports.offsets.push_back(reports.levels.size());
 	}
 
-	return report;
+	return reports;
 }
 
-std::vector<Report> parseReports(const std::string &input)
+ReportList parseReports(const std::string &input)
 {
-	std::ifstream file(input);
-	std::string line;
-	std::vector<Report> reports;
+	// Reports are independent lines, so they can be parsed in parallel chunks
+	ScanSequence ss(input, true);
+	std::vector<ReportList> chunks = ss.parseChunked<ReportList>(parseReportChunk);
+	if (chunks.size() == 1)
+		return std::move(chunks[0]);
 
-	while (std::getline(file, line))
+	// Join the chunks, shifting each chunk's offsets past the levels before it
+	ReportList reports;
+	size_t num_levels = 0, num_reports = 0;
+	for (const auto &chunk : chunks)
+	{
+		num_levels += chunk.levels.size();
+		num_reports += chunk.size();
+	}
+	reports.levels.reserve(num_levels);
+	reports.offsets.reserve(num_reports + 1);
+	for (const auto &chunk : chunks)
 	{
-		reports.push_back(splitStringToReport(line));
+		size_t base = reports.levels.size();
+		reports.levels.insert(reports.levels.end(), chunk.levels.begin(), chunk.levels.end());
+		for (size_t i = 1; i < chunk.offsets.size(); i++)
+		{
+			reports.offsets.push_back(base + chunk.offsets[i]);
+		}
 	}
 
-	file.close();
 	return reports;
 }
 
-bool isReportSafe(const Report &report)
+/// @brief Fold each adjacent difference of some levels into flags tracking whether the levels are still safely
+/// increasing or decreasing, without branching on each difference.
+/// @param levels the levels to check
+/// @param n the number of levels
+/// @param increasing cleared if any difference is outside 1..3
+/// @param decreasing cleared if any difference is outside -3..-1
+void foldLevelDiffs(const int *levels, size_t n, bool &increasing, bool &decreasing)
 {
-	int gradient = 0;
-	for (int i = 0; i < report.size() - 1; i++)
+	for (size_t i = 0; i + 1 < n; i++)
 	{
-		int thisDiff = report[i + 1] - report[i];
-		if (!gradient)
-		{
-			gradient = sign(thisDiff);
-		}
-		else
-		{
-			if (sign(thisDiff) != gradient)
-				return false;
-		}
+		int diff = levels[i + 1] - levels[i];
+		increasing &= diff >= 1 && diff <= 3;
+		decreasing &= diff >= -3 && diff <= -1;
+	}
+}
+
+/// @brief Check a report's levels for safety one difference at a time.
+/// @param levels the report's levels
+/// @param n the number of levels
+/// @return True if every adjacent difference is in 1..3, or every one is in -3..-1
+bool isReportSafeScalar(const int *levels, size_t n)
+{
+	bool increasing = true, decreasing = true;
+	foldLevelDiffs(levels, n, increasing, decreasing);
+	return increasing || decreasing;
+}
 
-		if (std::abs(thisDiff) < 1 || std::abs(thisDiff) > 3)
+#if defined(__x86_64__) || defined(__i386__)
+/// @brief As isReportSafeScalar, comparing 8 adjacent differences at a time. Needs AVX2.
+__attribute__((target("avx2"))) bool isReportSafeAVX2(const int *levels, size_t n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i four = _mm256_set1_epi32(4);
+	const __m256i minus_four = _mm256_set1_epi32(-4);
+	__m256i increasing = _mm256_set1_epi32(-1), decreasing = _mm256_set1_epi32(-1);
+
+	size_t i = 0;
+	for (; i + 8 < n; i += 8)
+	{
+		__m256i lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(levels + i));
+		__m256i rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(levels + i + 1));
+		__m256i diff = _mm256_sub_epi32(rhs, lhs);
+		increasing = _mm256_and_si256(increasing, _mm256_and_si256(_mm256_cmpgt_epi32(diff, zero), _mm256_cmpgt_epi32(four, diff)));
+		decreasing = _mm256_and_si256(decreasing, _mm256_and_si256(_mm256_cmpgt_epi32(zero, diff), _mm256_cmpgt_epi32(diff, minus_four)));
+
+		// Stop as soon as neither direction holds in every lane
+		if (_mm256_movemask_epi8(increasing) != -1 && _mm256_movemask_epi8(decreasing) != -1)
 			return false;
 	}
-	return true;
+
+	// Finish the last few differences one at a time
+	bool all_increasing = _mm256_movemask_epi8(increasing) == -1;
+	bool all_decreasing = _mm256_movemask_epi8(decreasing) == -1;
+	foldLevelDiffs(levels + i, n - i, all_increasing, all_decreasing);
+	return all_increasing || all_decreasing;
+}
+
+/// @brief As isReportSafeScalar, comparing 4 adjacent differences at a time. Needs SSE2.
+__attribute__((target("sse2"))) bool isReportSafeSSE2(const int *levels, size_t n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i four = _mm_set1_epi32(4);
+	const __m128i minus_four = _mm_set1_epi32(-4);
+	__m128i increasing = _mm_set1_epi32(-1), decreasing = _mm_set1_epi32(-1);
+
+	size_t i = 0;
+	for (; i + 4 < n; i += 4)
+	{
+		__m128i lhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(levels + i));
+		__m128i rhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(levels + i + 1));
+		__m128i diff = _mm_sub_epi32(rhs, lhs);
+		increasing = _mm_and_si128(increasing, _mm_and_si128(_mm_cmpgt_epi32(diff, zero), _mm_cmplt_epi32(diff, four)));
+		decreasing = _mm_and_si128(decreasing, _mm_and_si128(_mm_cmplt_epi32(diff, zero), _mm_cmpgt_epi32(diff, minus_four)));
+
+		// Stop as soon as neither direction holds in every lane
+		if (_mm_movemask_epi8(increasing) != 0xFFFF && _mm_movemask_epi8(decreasing) != 0xFFFF)
+			return false;
+	}
+
+	// Finish the last few differences one at a time
+	bool all_increasing = _mm_movemask_epi8(increasing) == 0xFFFF;
+	bool all_decreasing = _mm_movemask_epi8(decreasing) == 0xFFFF;
+	foldLevelDiffs(levels + i, n - i, all_increasing, all_decreasing);
+	return all_increasing || all_decreasing;
+}
+#endif
+
+typedef bool (*SafetyKernel)(const int *levels, size_t n);
+
+/// @brief Pick the widest safety kernel the CPU running the program supports
+SafetyKernel selectSafetyKernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return isReportSafeAVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return isReportSafeSSE2;
+#endif
+	return isReportSafeScalar;
+}
+
+static const SafetyKernel safetyKernel = selectSafetyKernel();
+
+bool isReportSafe(const Report &report)
+{
+	return safetyKernel(report.first, report.size());
 }
 
 int main()
 {
 	// std::string input = "test.txt";
 	std::string input = "input.txt";
-	std::vector<Report> reports = parseReports(input);
+	ReportList reports = parseReports(input);
 
 	int numSafe = 0;
-	for (auto r : reports)
+	for (size_t i = 0; i < reports.size(); i++)
 	{
-		numSafe += int(isReportSafe(r));
+		numSafe += int(isReportSafe(reports[i]));
 	}
 
 	std::cout << "Number of Safe Reports: " << numSafe << std::endl;
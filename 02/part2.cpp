@@ -4,105 +4,165 @@
 #include <fstream>
 #include <sstream>
 
-typedef std::vector<int> Report;
+#include "../scanner.h"
 
-int sign(int i)
+/// @brief A view of one report's levels inside a ReportList
+struct Report
 {
-	if (i == 0)
-		return 0;
-	if (i < 0)
-		return -1;
-	return 1;
-}
-
-Report splitStringToReport(const std::string &line)
+	const int *first;
+	const int *last;
+
+	size_t size() const { return last - first; }
+	const int &operator[](size_t i) const { return first[i]; }
+	const int *begin() const { return first; }
+	const int *end() const { return last; }
+};
+
+/// @brief Every report stored back to back in one flat array of levels.
+/// Report i is levels[offsets[i]] up to levels[offsets[i + 1]].
+struct ReportList
+{
+	std::vector<int> levels;
+	std::vector<size_t> offsets{0};
+
+	size_t size() const { return offsets.size() - 1; }
+	Report operator[](size_t i) const { return {levels.data() + offsets[i], levels.data() + offsets[i + 1]}; }
+};
+
+/// @brief Parse every line of space separated levels in a chunk into a ReportList. Empty lines are skipped,
+/// as are tokens that aren't levels.
+/// @param chunk a sequence over whole lines of the input
+/// @return the reports in the chunk
+ReportList parseReportChunk(ScanSequence &chunk)
 {
-	std::string tmp;
-	std::stringstream ss(line);
-	Report report;
-	while (std::getline(ss, tmp, ' '))
+	ReportList reports;
+	while (!chunk.isAtEnd())
 	{
-		report.push_back(std::stoi(tmp));
+		while (chunk.consumeString(' '))
+			;
+		// A '\r' ends the line as well, for CRLF line endings
+		while (!chunk.isAtEnd() && chunk.peekAtChar() != '\n' && chunk.peekAtChar() != '\r')
+		{
+			int level;
+			if (chunk.scanIntChecked(level))
+			{
+				reports.levels.push_back(level);
+			}
+			else
+			{
+				// Skip the rest of a token that isn't a level
+				while (!chunk.isAtEnd() && chunk.peekAtChar() != ' ' && chunk.peekAtChar() != '\n' && chunk.peekAtChar() != '\r')
+					chunk.scanChar();
+			}
+			while (chunk.consumeString(' '))
+				;
+		}
+		chunk.consumeString('\r');
+		chunk.consumeString('\n');
+
+		if (reports.levels.size() != reports.offsets.back())
+			reports.offsets.push_back(reports.levels.size());
 	}
 
-	return report;
+	return reports;
 }
 
-std::vector<Report> parseReports(const std::string &input)
+ReportList parseReports(const std::string &input)
 {
-	std::ifstream file(input);
-	std::string line;
-	std::vector<Report> reports;
-
-	while (std::getline(file, line))
+	// Reports are independent lines, so they can be parsed in parallel chunks
+	ScanSequence ss(input, true);
+	std::vector<ReportList> chunks = ss.parseChunked<ReportList>(parseReportChunk);
+	if (chunks.size() == 1)
+		return std::move(chunks[0]);
+
+	// Join the chunks, shifting each chunk's offsets past the levels before it
+	ReportList reports;
+	size_t num_levels = 0, num_reports = 0;
+	for (const auto &chunk : chunks)
+	{
+		num_levels += chunk.levels.size();
+		num_reports += chunk.size();
+	}
+	reports.levels.reserve(num_levels);
+	reports.offsets.reserve(num_reports + 1);
+	for (const auto &chunk : chunks)
 	{
-		reports.push_back(splitStringToReport(line));
+		size_t base = reports.levels.size();
+		reports.levels.insert(reports.levels.end(), chunk.levels.begin(), chunk.levels.end());
+		for (size_t i = 1; i < chunk.offsets.size(); i++)
+		{
+			reports.offsets.push_back(base + chunk.offsets[i]);
+		}
 	}
 
-	file.close();
 	return reports;
 }
 
-void printVec(Report r)
+/// @brief Check if a report can be made safe in one direction by removing at most max_removals levels.
+/// Walks the report once, tracking for each of the last max_removals + 1 levels the fewest removals that leave
+/// a safe prefix ending at that level. O(n * max_removals) time, and no allocations for small max_removals.
+/// @param report The report to check
+/// @param direction 1 if the levels must increase, -1 if they must decrease
+/// @param max_removals The number of levels that may be removed. A negative number never makes a report safe.
+/// @return True if the report can be made safe in this direction
+bool isReportSafeInDirection(const Report &report, int direction, int max_removals)
 {
-	for (auto x : r)
+	if (max_removals < 0)
+		return false;
+
+	const int STACK_WINDOW = 16;
+	int stack_window[STACK_WINDOW];
+	std::vector<int> heap_window;
+	int window_size = max_removals + 1;
+	int *fewest_removals = stack_window;
+	if (window_size > STACK_WINDOW)
 	{
-		std::cout << x << ", ";
+		heap_window.resize(window_size);
+		fewest_removals = heap_window.data();
 	}
-	std::cout << std::endl;
-}
 
-bool isReportSafe(const Report &report)
-{
-	int gradient = 0;
-	for (int i = 0; i < report.size() - 1; i++)
+	int n = report.size();
+	for (int i = 0; i < n; i++)
 	{
-		int thisDiff = report[i + 1] - report[i];
-		if (!gradient)
-		{
-			gradient = sign(thisDiff);
-		}
-		else
+		// Either every level before this one is removed, or the previous kept level is at most
+		// max_removals + 1 back with the levels in between removed
+		int best = i <= max_removals ? i : max_removals + 1;
+		for (int back = 1; back <= std::min(i, window_size); back++)
 		{
-			if (sign(thisDiff) != gradient)
-				return false;
+			int removals = fewest_removals[(i - back) % window_size] + back - 1;
+			int diff = (report[i] - report[i - back]) * direction;
+			if (removals < best && diff >= 1 && diff <= 3)
+				best = removals;
 		}
+		fewest_removals[i % window_size] = best;
 
-		if (std::abs(thisDiff) < 1 || std::abs(thisDiff) > 3)
-			return false;
+		// Finish early if removing every level after this one stays within the limit
+		if (best + (n - 1 - i) <= max_removals)
+			return true;
 	}
-	return true;
+
+	return n == 0;
 }
 
-bool isReportSafeWithDampener(const Report &report)
+/// @brief Check if a report is safe after removing at most max_removals levels.
+/// @param report The report to check
+/// @param max_removals The number of levels the dampener may remove
+/// @return True if the report can be made safe
+bool isReportSafeWithDampener(const Report &report, int max_removals = 1)
 {
-	// Check the report, removing one value each time to see if we can brute force a
-	// safe list
-	// Initially check the whole list
-	if (isReportSafe(report))
-		return true;
-
-	for (int i = 0; i < report.size(); i++)
-	{
-		Report copy(report);
-		copy.erase(copy.begin() + i);
-		if (isReportSafe(copy))
-			return true;
-	}
-
-	return false;
+	return isReportSafeInDirection(report, 1, max_removals) || isReportSafeInDirection(report, -1, max_removals);
 }
 
 int main()
 {
 	// std::string input = "test.txt";
 	std::string input = "input.txt";
-	std::vector<Report> reports = parseReports(input);
+	ReportList reports = parseReports(input);
 
 	int numSafe = 0;
-	for (auto r : reports)
+	for (size_t i = 0; i < reports.size(); i++)
 	{
-		numSafe += int(isReportSafeWithDampener(r));
+		numSafe += int(isReportSafeWithDampener(reports[i]));
 	}
 
 	std::cout << "Number of Safe Reports: " << numSafe << std::endl;
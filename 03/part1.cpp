@@ -1,27 +1,34 @@
 #include <string>
 #include <iostream>
 #include <fstream>
-#include <regex>
-#include <iterator>
+#include <vector>
 
-/// @brief Parse a string and extract all the occurances of 'mul(x,y)', where x and y are strings of digits. Multiplies the x and y integer values together
-/// and sums all occurances of the pattern.
-/// @param line a string
+#include "../instructions.h"
+
+/// @brief The only instruction is 'mul(x,y)', where x and y are strings of digits. Operands are limited to the
+/// 18 digits that always fit in a long long, and an instruction whose product doesn't fit is skipped, as in part 2
+constexpr auto MUL_INSTRUCTIONS = compileInstructions({{"mul", 2, 1, 18}});
+
+/// @brief Extract all the occurances of 'mul(x,y)' from a whole input. Multiplies the x and y integer values together
+/// and sums all occurances of the pattern. The input is streamed in fixed size blocks, so memory use stays constant
+/// however large the input is.
+/// @param input the stream to read
 /// @return The sum of the pattern values
-long long findAndSumMul(std::string &line)
+long long findAndSumMul(std::istream &input)
 {
-	std::regex mul_regex("mul\\(([0-9]+),([0-9]+)\\)", std::regex_constants::ECMAScript);
-	auto mul_begin = std::sregex_iterator(line.begin(), line.end(), mul_regex);
-	auto mul_end = std::sregex_iterator();
+	const size_t BLOCK_SIZE = 1 << 16;
+	std::vector<char> block(BLOCK_SIZE);
 
 	long long sum = 0;
-	for (auto it = mul_begin; it != mul_end; it++)
+	InstructionScanner scanner(MUL_INSTRUCTIONS, [&sum](size_t, const Operands &operands)
+							   {
+		long long value;
+		if (!__builtin_mul_overflow(operands[0], operands[1], &value))
+			sum += value; });
+	while (input.read(block.data(), BLOCK_SIZE) || input.gcount())
 	{
-		std::smatch match = *it;
-
-		sum += std::stoi(match[1].str()) * std::stoi(match[2].str());
+		scanner.feed(block.data(), block.data() + input.gcount());
 	}
-
 	return sum;
 }
 
@@ -30,15 +37,5 @@ int main()
 	std::string input = "input.txt";
 
 	std::ifstream file(input);
-	std::string line;
-	long long sum = 0;
-	while (std::getline(file, line))
-	{
-		long long x = findAndSumMul(line);
-		std::cout << "Sum of multiplies: ";
-		std::cout << x << std::endl;
-		sum += x;
-	}
-
-	std::cout << "\t\tFull Sum == " << sum << std::endl;
+	std::cout << "\t\tFull Sum == " << findAndSumMul(file) << std::endl;
 }
@@ -1,56 +1,262 @@
 #include <string>
 #include <iostream>
 #include <fstream>
-#include <regex>
-#include <iterator>
+#include <vector>
+#include <algorithm>
 
-/// @brief Parse a string and extract all the occurances of 'mul(x,y)', where x and y are strings of digits. Multiplies the x and y integer values together
-/// and sums all occurances of the pattern. Any 'do()' or 'don't()' occurances respectively allow or disallow the inclusion of the next pattern occurances.
-/// Inclusion is assumed to be allowed at the start of the pattern
+#include "../scanner.h"
+
+/// @brief A streaming state machine that extracts all the occurances of 'mul(x,y)', where x and y are strings of 1 to 18 digits.
+/// Multiplies the x and y integer values together and sums all occurances of the pattern. Any 'do()' or 'don't()' occurances
+/// respectively allow or disallow the inclusion of the next pattern occurances. Inclusion is assumed to be allowed at the start.
 /// E.g. mul(1,2)don't()mul(5,34)do()mul(2,10) should yield the value 1*2 + 2*10 == 22
-/// @param line a string
-/// @return The sum of the pattern values
-long long findAndSumMul(std::string &line)
+/// Input can be fed in any number of pieces, and patterns split across pieces are still found.
+/// Pattern values found before the first 'do()' or 'don't()' are kept apart, so a scanner started part way through
+/// the input can give its sum for either enable state at its start.
+class MulScanner
 {
-	std::regex mul_regex("do\\(\\)|don't\\(\\)|mul\\(([0-9]+),([0-9]+)\\)", std::regex_constants::ECMAScript);
-	auto mul_begin = std::sregex_iterator(line.begin(), line.end(), mul_regex);
-	auto mul_end = std::sregex_iterator();
+private:
+	// Each state is named for the part of a pattern matched so far
+	enum State
+	{
+		START,
+		M,
+		MU,
+		MUL,
+		MUL_OPEN,
+		MUL_X,
+		MUL_COMMA,
+		MUL_Y,
+		D,
+		DO,
+		DO_OPEN,
+		DON,
+		DON_QUOTE,
+		DONT,
+		DONT_OPEN
+	};
 
+	// Operands are limited to the 18 digits that always fit in a long long, as in part 1
+	static const int MAX_OPERAND_DIGITS = 18;
+
+	State state = START;
+	long long x = 0;
+	long long y = 0;
+	int digits = 0;
+	bool toggled = false;
 	bool sum_enabled = true;
+	long long untoggled_sum = 0;
 	long long sum = 0;
-	for (auto it = mul_begin; it != mul_end; it++)
+
+	/// @brief Advance the state machine by one character
+	void step(char c);
+
+public:
+	/// @brief Scan the next piece of input
+	void feed(const char *begin, const char *end)
 	{
-		std::smatch match = *it;
+		for (const char *c = begin; c != end; c++)
+		{
+			step(*c);
+		}
+	}
+
+	/// @brief Scan past the end of this scanner's piece of input, only until a pattern that started inside the piece
+	/// has been matched or has failed. Stops at any 'm' or 'd', as that is where the next piece's patterns start.
+	void finish(const char *begin, const char *end)
+	{
+		for (const char *c = begin; c != end && state != START && *c != 'm' && *c != 'd'; c++)
+		{
+			step(*c);
+		}
+	}
+
+	/// @brief The sum of the enabled pattern values found so far
+	/// @param started_enabled whether inclusion was allowed where this scanner started
+	long long total(bool started_enabled = true) const { return (started_enabled ? untoggled_sum : 0) + sum; }
+
+	/// @brief Whether inclusion is allowed after everything scanned so far
+	/// @param started_enabled whether inclusion was allowed where this scanner started
+	bool enabled(bool started_enabled = true) const { return toggled ? sum_enabled : started_enabled; }
+};
 
-		if (match.str() == "do()")
+void MulScanner::step(char c)
+{
+	bool digit = c >= '0' && c <= '9';
+	switch (state)
+	{
+	case START:
+		break;
+	case M:
+		if (c == 'u')
+		{
+			state = MU;
+			return;
+		}
+		break;
+	case MU:
+		if (c == 'l')
+		{
+			state = MUL;
+			return;
+		}
+		break;
+	case MUL:
+		if (c == '(')
+		{
+			state = MUL_OPEN;
+			return;
+		}
+		break;
+	case MUL_OPEN:
+		if (digit)
+		{
+			x = c - '0';
+			digits = 1;
+			state = MUL_X;
+			return;
+		}
+		break;
+	case MUL_X:
+		if (digit && digits < MAX_OPERAND_DIGITS)
+		{
+			x = x * 10 + (c - '0');
+			digits++;
+			return;
+		}
+		if (c == ',')
+		{
+			state = MUL_COMMA;
+			return;
+		}
+		break;
+	case MUL_COMMA:
+		if (digit)
 		{
+			y = c - '0';
+			digits = 1;
+			state = MUL_Y;
+			return;
+		}
+		break;
+	case MUL_Y:
+		if (digit && digits < MAX_OPERAND_DIGITS)
+		{
+			y = y * 10 + (c - '0');
+			digits++;
+			return;
+		}
+		long long value;
+		// A product too large for a long long fails the match
+		if (c == ')' && !__builtin_mul_overflow(x, y, &value))
+		{
+			if (!toggled)
+				untoggled_sum += value;
+			else if (sum_enabled)
+				sum += value;
+			state = START;
+			return;
+		}
+		break;
+	case D:
+		if (c == 'o')
+		{
+			state = DO;
+			return;
+		}
+		break;
+	case DO:
+		if (c == '(')
+		{
+			state = DO_OPEN;
+			return;
+		}
+		if (c == 'n')
+		{
+			state = DON;
+			return;
+		}
+		break;
+	case DO_OPEN:
+		if (c == ')')
+		{
+			toggled = true;
 			sum_enabled = true;
+			state = START;
+			return;
 		}
-		else if (match.str() == "don't()")
+		break;
+	case DON:
+		if (c == '\'')
 		{
-			sum_enabled = false;
+			state = DON_QUOTE;
+			return;
+		}
+		break;
+	case DON_QUOTE:
+		if (c == 't')
+		{
+			state = DONT;
+			return;
 		}
-		else if (sum_enabled)
+		break;
+	case DONT:
+		if (c == '(')
 		{
-			sum += std::stoi(match[1].str()) * std::stoi(match[2].str());
+			state = DONT_OPEN;
+			return;
 		}
+		break;
+	case DONT_OPEN:
+		if (c == ')')
+		{
+			toggled = true;
+			sum_enabled = false;
+			state = START;
+			return;
+		}
+		break;
 	}
 
-	return sum;
+	// The pattern didn't continue. No partial match contains an 'm' or 'd' after its first character,
+	// so the only place a new match can start is this character.
+	state = c == 'm' ? M : c == 'd' ? D : START;
 }
 
-int main()
+/// @brief Sum the enabled pattern values of a whole buffer using several threads. Each thread scans one chunk, owning
+/// every pattern that starts inside it, and gives its sum for both enable states at its start. The chunks are then
+/// stitched together in order, each one starting in the enable state the chunk before it ended in.
+/// @param input the buffer to scan
+/// @param threads The number of threads to use. Defaults to the hardware concurrency, and small inputs use fewer threads.
+/// @return The sum of the pattern values, exactly as a serial scan would find it
+long long findAndSumMul(std::string_view input, unsigned threads = 0)
 {
-	std::string input = "input.txt";
+	const size_t MIN_CHUNK_SIZE = 1 << 16; // bytes
+
+	threads = threadCount(input.size(), MIN_CHUNK_SIZE, threads);
 
-	std::ifstream file(input);
-	std::string line;
-	std::string fullString;
+	const char *begin = input.data();
+	const char *end = begin + input.size();
+	std::vector<MulScanner> chunks(threads);
+	parallelRanges(input.size(), threads, [&](unsigned t, size_t chunk_begin, size_t chunk_end)
+				   {
+		chunks[t].feed(begin + chunk_begin, begin + chunk_end);
+		chunks[t].finish(begin + chunk_end, end); });
+
+	bool enabled = true;
 	long long sum = 0;
-	while (std::getline(file, line))
+	for (const auto &chunk : chunks)
 	{
-		fullString += line;
+		sum += chunk.total(enabled);
+		enabled = chunk.enabled(enabled);
 	}
+	return sum;
+}
+
+int main()
+{
+	std::string input = "input.txt";
 
-	std::cout << "\t\tFull Sum == " << findAndSumMul(fullString) << std::endl;
+	ScanSequence ss(input, true);
+	std::cout << "\t\tFull Sum == " << findAndSumMul(ss.remaining()) << std::endl;
 }
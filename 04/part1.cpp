@@ -2,6 +2,10 @@
 #include <vector>
 #include <fstream>
 #include <string>
+#include <algorithm>
+
+#include "../bitplanes.h"
+#include "../wordautomaton.h"
 
 using namespace std;
 
@@ -15,40 +19,33 @@ struct coord
 class WordSearcher
 {
 private:
-	vector<vector<char>> grid;
+	Grid<char> grid;
+	BitPlanes planes;
 	const vector<coord> adjDirs = {
 		{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
 
 	void readFile(const string &f);
-	vector<coord> allCharCoords(char c) const;
 	bool inBounds(const coord &pos) const;
-	vector<coord> getAdjacent(coord pos) const;
-	inline char at(coord pos) const { return grid[pos.x][pos.y]; };
-	inline char at(int r, int c) const { return grid[r][c]; };
 
-	int findMatchesAux(const string &word, const coord &dir, coord pos) const;
+	// Split the rows into one band per thread and return the sum of f(begin, end) over every band,
+	// with the bands run in parallel
+	template <typename F>
+	int sumOverRowBands(unsigned threads, F f) const;
 
 public:
 	WordSearcher(const string &input);
 
-	int findMatches(const string &word) const;
+	int findMatches(const string &word, unsigned threads = 0) const;
+
+	vector<long long> findMatches(const vector<string> &words) const;
 };
 
 void WordSearcher::readFile(const string &f)
 {
-	grid.clear();
-	string line;
-	ifstream file(f);
-
-	while (getline(file, line))
-	{
-		grid.push_back({});
-		for (auto c : line)
-		{
-			grid.back().push_back(c);
-		}
-	}
-	file.close();
+	ScanSequence ss(f, true);
+	grid = Grid<char>::load(ss, [](char c, int, int)
+							{ return c; });
+	planes = BitPlanes(grid);
 }
 
 WordSearcher::WordSearcher(const string &input)
@@ -56,79 +53,89 @@ WordSearcher::WordSearcher(const string &input)
 	readFile(input);
 }
 
-// Get a vector of all coordinates which contain the given character.
-vector<coord> WordSearcher::allCharCoords(char c) const
-{
-	vector<coord> coords;
-	for (int i = 0; i < grid.size(); i++)
-	{
-		for (int j = 0; j < grid[i].size(); j++)
-		{
-			if (at(i, j) == c)
-				coords.push_back({i, j});
-		}
-	}
-	return coords;
-}
-
 bool WordSearcher::inBounds(const coord &pos) const
 {
-	return (pos.x >= 0 && pos.x < grid.size() && pos.y >= 0 && pos.y < grid[pos.x].size());
+	return grid.inBounds(pos.x, pos.y);
 }
 
-vector<coord> WordSearcher::getAdjacent(coord pos) const
+// Each band only counts matches anchored on its own rows, so no match is counted twice. A match can still
+// reach up to word length - 1 rows beyond the band, and those halo rows are read straight from the shared
+// bitplanes rather than being copied into the band.
+template <typename F>
+int WordSearcher::sumOverRowBands(unsigned threads, F f) const
 {
-	vector<coord> adj;
-	for (auto dir : adjDirs)
+	const size_t MIN_CELLS_PER_THREAD = 1 << 18; // grid cells
+
+	int rows = grid.numRows();
+	threads = threadCount(size_t(rows) * grid.numCols(), MIN_CELLS_PER_THREAD, threads);
+	threads = max(1u, min<unsigned>(threads, rows));
+
+	vector<int> partial(threads, 0);
+	parallelRanges(rows, threads, [&](unsigned t, size_t begin, size_t end)
+				   { partial[t] = f(int(begin), int(end)); });
+
+	int total = 0;
+	for (int count : partial)
 	{
-		coord d = dir + pos;
-		if (inBounds(d))
-		{
-			adj.push_back(d);
-		}
+		total += count;
 	}
-	return adj;
+	return total;
 }
 
 // Find all versions of a given word in the grid. The word can be matched in all directions,
 // but must be in a straight line. Letters can be used multiple times.
-// Start by finding all positions of the starting letter, then search in every direction from each starting letter for the complete word.
-int WordSearcher::findMatches(const string &word) const
+// Each row is matched in every direction at once from the letter bitplanes, 64 starting columns at a time.
+// Bands of rows are searched in parallel, using up to 'threads' threads (defaulting to the hardware concurrency).
+int WordSearcher::findMatches(const string &word, unsigned threads) const
 {
-	int total = 0;
-	for (int i = 0; i < grid.size(); i++)
-	{
-		for (int j = 0; j < grid[i].size(); j++)
+	if (word.empty())
+		return 0;
+
+	return sumOverRowBands(threads, [&](int begin, int end)
+						   {
+		int total = 0;
+		vector<uint64_t> matched(planes.wordsPerRow());
+		for (int i = begin; i < end; i++)
 		{
-			if (at(i, j) == word[0])
+			for (auto dir : adjDirs)
 			{
-				// Search from this correct starting position in up to 8 different directions.
-				for (auto dir : adjDirs)
-				{
-					total += findMatchesAux(word, dir, {i, j});
-				}
+				if (planes.matchRow(word, 0, dir.x, dir.y, i, matched.data()))
+					total += BitPlanes::popcount(matched.data(), matched.size());
 			}
 		}
-	}
-
-	return total;
+		return total; });
 }
 
-// word has already found in the range [0, idx). We know that grid[pos] == word[idx - 1]
-// Check if we've finished the word, so idx == |word|
-// Continue the search in the given direction, checking each new position for leaving the board or not a match.
-// Return the number of matches, which can only be 1 for the given direction.
-int WordSearcher::findMatchesAux(const string &word, const coord &dir, coord pos) const
+// Find all versions of every word in the grid, matched the same way as findMatches does for one word,
+// and return the number of matches of each word.
+// Every line through the grid (rows, columns, both diagonals, and their reverses) is streamed once through
+// an Aho-Corasick automaton over all the words, so the cost doesn't grow with the number of words.
+vector<long long> WordSearcher::findMatches(const vector<string> &words) const
 {
-	for (int i = 1; i < word.size(); i++)
+	WordAutomaton automaton(words);
+	vector<long long> hits(automaton.numNodes(), 0);
+	for (int i = 0; i < grid.numRows(); i++)
 	{
-		pos = pos + dir;
-		if (!inBounds(pos) || at(pos) != word[i])
+		// Every line starts on the edge of the grid, so only visit the edge cells
+		bool edgeRow = i == 0 || i == grid.numRows() - 1;
+		for (int j = 0; j < grid.numCols(); j = (edgeRow || j == grid.numCols() - 1) ? j + 1 : grid.numCols() - 1)
 		{
-			return 0;
+			for (auto dir : adjDirs)
+			{
+				// Start a line here if the cell before it in this direction is off the grid
+				if (inBounds({i - dir.x, j - dir.y}))
+					continue;
+
+				int node = WordAutomaton::ROOT;
+				for (coord pos = {i, j}; inBounds(pos); pos = pos + dir)
+				{
+					node = automaton.step(node, grid.at(pos.x, pos.y));
+					hits[node]++;
+				}
+			}
 		}
 	}
-	return 1;
+	return automaton.wordCounts(hits);
 }
 
 int main()
@@ -2,6 +2,9 @@
 #include <vector>
 #include <fstream>
 #include <string>
+#include <algorithm>
+
+#include "../bitplanes.h"
 
 using namespace std;
 
@@ -15,49 +18,32 @@ struct coord
 class WordSearcher
 {
 private:
-	vector<vector<char>> grid;
-
+	Grid<char> grid;
+	BitPlanes planes;
 	const vector<coord> adjDirs = {
 		{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
 
 	void readFile(const string &f);
 
-	vector<coord> allCharCoords(char c) const;
-
-	bool inBounds(const coord &pos) const;
-
-	bool onGridEdge(const coord &pos) const;
-
-	vector<coord> getAdjacent(coord pos) const;
-
-	inline char at(coord pos) const { return grid[pos.x][pos.y]; };
-	inline char at(int r, int c) const { return grid[r][c]; };
-
-	int findMatchesAux(const string &word, const coord &dir, coord pos) const;
+	// Split the rows into one band per thread and return the sum of f(begin, end) over every band,
+	// with the bands run in parallel
+	template <typename F>
+	int sumOverRowBands(unsigned threads, F f) const;
 
 public:
 	WordSearcher(const string &input);
 
-	int findMatches(const string &word) const;
+	int findMatches(const string &word, unsigned threads = 0) const;
 
-	int findCrossMatches() const;
+	int findCrossMatches(unsigned threads = 0) const;
 };
 
 void WordSearcher::readFile(const string &f)
 {
-	grid.clear();
-	string line;
-	ifstream file(f);
-
-	while (getline(file, line))
-	{
-		grid.push_back({});
-		for (auto c : line)
-		{
-			grid.back().push_back(c);
-		}
-	}
-	file.close();
+	ScanSequence ss(f, true);
+	grid = Grid<char>::load(ss, [](char c, int, int)
+							{ return c; });
+	planes = BitPlanes(grid);
 }
 
 WordSearcher::WordSearcher(const string &input)
@@ -65,83 +51,52 @@ WordSearcher::WordSearcher(const string &input)
 	readFile(input);
 }
 
-// Get a vector of all coordinates which contain the given character.
-vector<coord> WordSearcher::allCharCoords(char c) const
+// Each band only counts matches anchored on its own rows, so no match is counted twice. A match can still
+// reach up to word length - 1 rows beyond the band, and those halo rows are read straight from the shared
+// bitplanes rather than being copied into the band.
+template <typename F>
+int WordSearcher::sumOverRowBands(unsigned threads, F f) const
 {
-	vector<coord> coords;
-	for (int i = 0; i < grid.size(); i++)
-	{
-		for (int j = 0; j < grid[i].size(); j++)
-		{
-			if (at(i, j) == c)
-				coords.push_back({i, j});
-		}
-	}
-	return coords;
-}
+	const size_t MIN_CELLS_PER_THREAD = 1 << 18; // grid cells
 
-bool WordSearcher::inBounds(const coord &pos) const
-{
-	return (pos.x >= 0 && pos.x < grid.size() && pos.y >= 0 && pos.y < grid[pos.x].size());
-}
+	int rows = grid.numRows();
+	threads = threadCount(size_t(rows) * grid.numCols(), MIN_CELLS_PER_THREAD, threads);
+	threads = max(1u, min<unsigned>(threads, rows));
 
-bool WordSearcher::onGridEdge(const coord &pos) const
-{
-	return (pos.x == 0 || pos.y == 0 || pos.x == grid.size() - 1 || pos.y == grid[pos.x].size() - 1);
-}
-vector<coord> WordSearcher::getAdjacent(coord pos) const
-{
-	vector<coord> adj;
-	for (auto dir : adjDirs)
+	vector<int> partial(threads, 0);
+	parallelRanges(rows, threads, [&](unsigned t, size_t begin, size_t end)
+				   { partial[t] = f(int(begin), int(end)); });
+
+	int total = 0;
+	for (int count : partial)
 	{
-		coord d = dir + pos;
-		if (inBounds(d))
-		{
-			adj.push_back(d);
-		}
+		total += count;
 	}
-	return adj;
+	return total;
 }
 
 // Find all versions of a given word in the grid. The word can be matched in all directions,
 // but must be in a straight line. Letters can be used multiple times.
-// Start by finding all positions of the starting letter, then search in every direction from each starting letter for the complete word.
-int WordSearcher::findMatches(const string &word) const
+// Each row is matched in every direction at once from the letter bitplanes, 64 starting columns at a time.
+// Bands of rows are searched in parallel, using up to 'threads' threads (defaulting to the hardware concurrency).
+int WordSearcher::findMatches(const string &word, unsigned threads) const
 {
-	int total = 0;
-	for (int i = 0; i < grid.size(); i++)
-	{
-		for (int j = 0; j < grid[i].size(); j++)
+	if (word.empty())
+		return 0;
+
+	return sumOverRowBands(threads, [&](int begin, int end)
+						   {
+		int total = 0;
+		vector<uint64_t> matched(planes.wordsPerRow());
+		for (int i = begin; i < end; i++)
 		{
-			if (at(i, j) == word[0])
+			for (auto dir : adjDirs)
 			{
-				// Search from this correct starting position in up to 8 different directions.
-				for (auto dir : adjDirs)
-				{
-					total += findMatchesAux(word, dir, {i, j});
-				}
+				if (planes.matchRow(word, 0, dir.x, dir.y, i, matched.data()))
+					total += BitPlanes::popcount(matched.data(), matched.size());
 			}
 		}
-	}
-
-	return total;
-}
-
-// word has already found in the range [0, idx). We know that grid[pos] == word[idx - 1]
-// Check if we've finished the word, so idx == |word|
-// Continue the search in the given direction, checking each new position for leaving the board or not a match.
-// Return the number of matches, which can only be 1 for the given direction.
-int WordSearcher::findMatchesAux(const string &word, const coord &dir, coord pos) const
-{
-	for (int i = 1; i < word.size(); i++)
-	{
-		pos = pos + dir;
-		if (!inBounds(pos) || at(pos) != word[i])
-		{
-			return 0;
-		}
-	}
-	return 1;
+		return total; });
 }
 
 // Find the cross matches of a word in the grid. A cross match is two diagonal copies of a word that overlap on the middle char.
@@ -150,27 +105,35 @@ int WordSearcher::findMatchesAux(const string &word, const coord &dir, coord pos
 //   . A .
 //   S . M
 // For now, assume the word is MAS to decrease work needed to code.
-int WordSearcher::findCrossMatches() const
+// Each diagonal is matched for a whole row at once from the letter bitplanes, anchored on the middle char,
+// so the columns where both diagonals read MAS either way round are the X-MAS centres. Bands of rows are searched in parallel.
+int WordSearcher::findCrossMatches(unsigned threads) const
 {
-	coord ul = {-1, -1}, br = {1, 1}, ur = {-1, 1}, bl = {1, -1};
-	// Work through every A in the grid, as it must be the middle of the X-MAS
-	int matches = 0;
-	for (auto pos : allCharCoords('A'))
-	{
-		// Check that the A is not on the edge of the board
-		if (onGridEdge(pos))
-			continue;
-
-		// Check that both MAS are there on the diagonals
-		pair<coord, coord>
-			diag1 = {pos + ul, pos + br},
-			diag2 = {pos + ur, pos + bl};
-
-		bool diag1Correct = ((at(diag1.first) == 'M' && at(diag1.second) == 'S') || (at(diag1.first) == 'S' && at(diag1.second) == 'M'));
-		bool diag2Correct = ((at(diag2.first) == 'M' && at(diag2.second) == 'S') || (at(diag2.first) == 'S' && at(diag2.second) == 'M'));
-		matches += int(diag1Correct && diag2Correct);
-	}
-	return matches;
+	const string word = "MAS";
+	const int mid = word.size() / 2;
+
+	return sumOverRowBands(threads, [&](int begin, int end)
+						   {
+		int matches = 0;
+		int words = planes.wordsPerRow();
+		vector<uint64_t> diag1(words), diag2(words), other(words);
+		for (int i = begin; i < end; i++)
+		{
+			// Top left to bottom right, either way round
+			planes.matchRow(word, mid, 1, 1, i, diag1.data());
+			planes.matchRow(word, mid, -1, -1, i, other.data());
+			for (int w = 0; w < words; w++)
+				diag1[w] |= other[w];
+
+			// Top right to bottom left, either way round
+			planes.matchRow(word, mid, 1, -1, i, diag2.data());
+			planes.matchRow(word, mid, -1, 1, i, other.data());
+			for (int w = 0; w < words; w++)
+				diag2[w] = (diag2[w] | other[w]) & diag1[w];
+
+			matches += BitPlanes::popcount(diag2.data(), words);
+		}
+		return matches; });
 }
 
 int main()
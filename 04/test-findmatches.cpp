@@ -0,0 +1,65 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <cstdio>
+
+// Reuse WordSearcher from part 1, without its main
+#define main part1_main
+#include "part1.cpp"
+#undef main
+
+using namespace std;
+
+// Checks that the multi-word findMatches gives every word the same count as the single word findMatches,
+// over the puzzle input and random grids of every shape from 1x1 up. The words include palindromes,
+// duplicates, single letters, an empty word, and words that are longer than the grid or use letters
+// that aren't in it. Prints one line per grid, and exits non zero if any of them fail.
+// Build with: g++ -std=c++17 -O2 -pthread test-findmatches.cpp -o test-findmatches
+
+const vector<string> WORDS = {"XMAS", "SAMX", "XMAS", "MAM", "AMMA", "A", "", "MM", "XMASXMASXMAS", "XQ", "S"};
+const string GRID_FILE = "test-findmatches-grid.txt";
+
+int failures = 0;
+
+void check(const string &input, const string &what)
+{
+	WordSearcher ws(input);
+	vector<long long> counts = ws.findMatches(WORDS);
+
+	bool ok = counts.size() == WORDS.size();
+	for (size_t i = 0; ok && i < WORDS.size(); i++)
+	{
+		ok = counts[i] == ws.findMatches(WORDS[i]);
+	}
+	cout << (ok ? "ok   " : "FAIL ") << what << endl;
+	failures += !ok;
+}
+
+int main()
+{
+	check("input.txt", "puzzle input");
+
+	mt19937 rng(4);
+	const string letters = "XMAS";
+	for (int rows = 1; rows <= 9; rows += 2)
+	{
+		for (int cols = 1; cols <= 70; cols += 23)
+		{
+			ofstream grid(GRID_FILE);
+			for (int r = 0; r < rows; r++)
+			{
+				for (int c = 0; c < cols; c++)
+				{
+					grid << letters[rng() % letters.size()];
+				}
+				grid << '\n';
+			}
+			grid.close();
+			check(GRID_FILE, to_string(rows) + "x" + to_string(cols) + " random grid");
+		}
+	}
+	remove(GRID_FILE.c_str());
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+// Reuse PrintOrdering from part 2, without its main
+#define main part2_main
+#include "part2.cpp"
+#undef main
+
+using namespace std;
+
+// Benchmark of finding the median of incorrectly ordered updates, in updates/second, comparing find_median
+// against sorting each update with sort_update and taking its middle page. The rules are a total order over
+// 1000 pages, as in the puzzle input, so find_median always finds the median. Updates of a few lengths are
+// generated by shuffling random pages, 5000 of each unless a count is given.
+// Build with: g++ -std=c++17 -O2 -pthread bench-median.cpp -o bench-median
+
+const int NUM_PAGES = 1000;
+
+// Time 'median' over every update, and report updates/second
+template <typename F>
+void bench(const string &name, const vector<update> &updates, F median)
+{
+	auto start = chrono::steady_clock::now();
+	long long checksum = 0;
+	for (const update &up : updates)
+	{
+		checksum += median(up);
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << "  " << name << ": " << updates.size() / seconds / 1e6 << " M updates/s (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 5000;
+	mt19937 rng(5);
+
+	// Every pair of pages gets a rule, in the order of a random permutation
+	vector<int> order(NUM_PAGES);
+	for (int i = 0; i < NUM_PAGES; i++)
+	{
+		order[i] = i;
+	}
+	shuffle(order.begin(), order.end(), rng);
+	PrintOrdering po;
+	for (int i = 0; i < NUM_PAGES; i++)
+	{
+		for (int j = i + 1; j < NUM_PAGES; j++)
+		{
+			po.add_rule(order[i], order[j]);
+		}
+	}
+
+	for (int length : {23, 101, 501})
+	{
+		vector<update> updates(count);
+		vector<int> pages(order);
+		for (update &up : updates)
+		{
+			shuffle(pages.begin(), pages.end(), rng);
+			up.assign(pages.begin(), pages.begin() + length);
+		}
+
+		cout << length << " pages per update" << endl;
+		bench("sort_update", updates, [&](const update &up)
+			  {
+			update sorted = po.sort_update(up);
+			return sorted[sorted.size() / 2]; });
+		bench("find_median", updates, [&](const update &up)
+			  {
+			int median = 0;
+			po.find_median(up, median);
+			return median; });
+	}
+	return 0;
+}
@@ -1,9 +1,13 @@
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include <stdexcept>
+#include <stdint.h>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+
+#include "../scanner.h"
 
 using namespace std;
 
@@ -16,7 +20,21 @@ typedef vector<int> pages;
 class PrintOrdering
 {
 private:
-	unordered_map<int, pages> conditional_key_before_values;
+	// The rules as a dense adjacency matrix indexed directly by page number. Row lhs holds rule_words words,
+	// with bit (rhs % 64) of word (rhs / 64) set for each rule lhs|rhs. Page numbers are small, so the matrix
+	// covers every page from 0 up to page_limit - 1, and no page past that is part of any rule
+	vector<uint64_t> rule_after;
+	int page_limit = 0;
+	int rule_words = 0;
+
+	/// @brief Get the row of the rule matrix for a page
+	/// @param page a page number in [0, page_limit)
+	/// @return a pointer to the rule_words words of pages that must be printed after `page`
+	const uint64_t *pages_after(int page) const { return &rule_after[size_t(page) * rule_words]; }
+
+	/// @brief Rebuild the rule matrix from a list of rules
+	/// @param rules each rule as a pair {before, after}
+	void build_rules(const vector<pair<int, int>> &rules);
 
 	vector<update> all_updates;
 
@@ -38,62 +56,79 @@ public:
 	size_t num_updates() const { return all_updates.size(); };
 };
 
-void PrintOrdering::parse_conditional_file(const string &input)
+void PrintOrdering::build_rules(const vector<pair<int, int>> &rules)
 {
-	conditional_key_before_values.clear();
-	all_updates.clear();
+	page_limit = 0;
+	for (auto rule : rules)
+	{
+		if (rule.first < 0 || rule.second < 0)
+			throw invalid_argument("page numbers in rules can't be negative");
+		page_limit = max(page_limit, max(rule.first, rule.second) + 1);
+	}
+	rule_words = (page_limit + 63) / 64;
 
-	ifstream file(input);
-	string line;
-	while (getline(file, line) && line.size() != 0)
+	rule_after.assign(size_t(page_limit) * rule_words, 0);
+	for (auto rule : rules)
 	{
-		// Parse the pairs of conditions
-		size_t sep_pos = line.find_first_of('|');
-		int before = stoi(line.substr(0, sep_pos));
-		int after = stoi(line.substr(sep_pos + 1));
-		conditional_key_before_values[before].push_back(after);
+		rule_after[size_t(rule.first) * rule_words + rule.second / 64] |= uint64_t(1) << (rule.second % 64);
 	}
+}
+
+void PrintOrdering::parse_conditional_file(const string &input)
+{
+	all_updates.clear();
 
-	while (getline(file, line))
+	vector<pair<int, int>> rules;
+	ScanSequence ss(input, true);
+	while (!ss.isAtEnd() && ss.peekAtChar() != '\n' && ss.peekAtChar() != '\r')
 	{
-		// Parse the lists of pages to print
-		stringstream line_stream(line);
-		string page;
-		vector<int> these_pages;
-		while (getline(line_stream, page, ','))
+		// Parse the pairs of conditions, stopping at anything that isn't one
+		int before, after;
+		if (!ss.scanIntChecked(before) || !ss.consumeString('|') || !ss.scanIntChecked(after))
+			break;
+		ss.consumeString('\r');
+		ss.consumeString('\n');
+		rules.push_back({before, after});
+	}
+	ss.consumeWhitespace();
+	build_rules(rules);
+
+	// Parse the lists of pages to print. Each line is independent, so parse them in parallel chunks
+	all_updates = ss.parseLinesChunked<update>([](ScanSequence &line)
+											   {
+		update these_pages;
+		while (!line.isAtEnd())
 		{
-			these_pages.push_back(stoi(page));
+			// Stop at anything that isn't a page number, rather than adding a bogus page
+			int page;
+			if (!line.scanIntChecked(page))
+				break;
+			these_pages.push_back(page);
+			line.consumeString(',');
 		}
-
-		all_updates.push_back(these_pages);
-	}
-
-	file.close();
+		return these_pages; });
 }
 
 bool PrintOrdering::check_update(int update_idx) const
 {
 	const update &up = all_updates[update_idx];
-	unordered_map<int, int> page_to_position;
+	vector<uint64_t> seen(rule_words, 0);
 
-	// Iterate through every page in this update in order, recording the position each page appears at
-	for (int i = 0; i < up.size(); i++)
+	// Iterate through every page in this update in order, recording each page in a bitmask as it is seen.
+	// A page is out of order if any page that must be printed after it has already been seen.
+	// Pages past page_limit aren't part of any rule, so they can't break one
+	for (int page : up)
 	{
-		int page = up[i];
-		page_to_position[page] = i;
-
-		// Check if there are any conditions on this page value
-		if (!conditional_key_before_values.count(page))
+		if (page < 0 || page >= page_limit)
 			continue;
-		// Iterate through our stored conditions and check every page that is required to be after the current page
-		// Check if the 'after' pages have been seen before, and if they've appeared before the current page
-		for (auto page_after : conditional_key_before_values.at(page))
+
+		const uint64_t *after = pages_after(page);
+		for (int w = 0; w < rule_words; w++)
 		{
-			if (page_to_position.count(page_after) && page_to_position.at(page_after) < i)
-			{
+			if (after[w] & seen[w])
 				return false;
-			}
 		}
+		seen[page / 64] |= uint64_t(1) << (page % 64);
 	}
 
 	return true;
@@ -1,11 +1,14 @@
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include <stdexcept>
+#include <stdint.h>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 
+#include "../scanner.h"
+
 using namespace std;
 
 typedef vector<int> update;
@@ -17,144 +20,554 @@ typedef vector<int> pages;
 class PrintOrdering
 {
 private:
-	unordered_map<int, pages> conditional_key_before_values;
+	// The rules as a dense adjacency matrix indexed directly by page number. Row lhs holds rule_words words,
+	// with bit (rhs % 64) of word (rhs / 64) set for each rule lhs|rhs. Page numbers are small, so the matrix
+	// covers every page from 0 up to page_limit - 1, and no page past that is part of any rule. Rules can be added
+	// and removed in place, and the matrix grows when a rule names a page past page_limit
+	vector<uint64_t> rule_after;
+	int page_limit = 0;
+	int rule_words = 0;
+
+	// The largest page number a rule can name. The matrix takes page_limit^2 / 8 bytes, so this keeps it to 32 MB
+	static const int MAX_PAGE = (1 << 14) - 1;
+
+	/// @brief Throw invalid_argument if a page can't be part of a rule
+	/// @param page a page number from a rule
+	static void check_rule_page(int page);
+
+	/// @brief Get the row of the rule matrix for a page
+	/// @param page a page number in [0, page_limit)
+	/// @return a pointer to the rule_words words of pages that must be printed after `page`
+	const uint64_t *pages_after(int page) const { return &rule_after[size_t(page) * rule_words]; }
+
+	/// @brief Rebuild the rule matrix from a list of rules
+	/// @param rules each rule as a pair {before, after}
+	void build_rules(const vector<pair<int, int>> &rules);
+
+	/// @brief Grow the rule matrix to cover pages up to at least limit - 1, keeping every rule in it.
+	/// The matrix at least doubles each time it grows, up to MAX_PAGE + 1 pages, so adding rules one at a time rarely copies it.
+	/// @param limit the number of pages to cover
+	void grow_rules(int limit);
 
 	vector<update> all_updates;
 
+	static const size_t MIN_UPDATES_PER_THREAD = 1 << 12; // updates
+
 	/// @brief Checks if lhs needs to appear before rhs in the print output ordering.
 	/// @param lhs a page number
 	/// @param rhs second page number
 	/// @return Returns true if the pair lhs|rhs exists in the input file, otherwise returns false
 	bool printBefore(int lhs, int rhs) const;
 
+	/// @brief Checks an update for valid ordering, using a bitmask over page numbers that is reused across calls
+	/// @param up the update to check
+	/// @param marks rule_words words, all zero. They are all zero again on return
+	/// @return True if correctly ordered.
+	bool check_pages(const update &up, vector<uint64_t> &marks) const;
+
+	/// @brief find_median, using a bitmask over page numbers that is reused across calls
+	/// @param marks rule_words words, all zero. They are all zero again on return
+	bool find_median(const update &up, int &median, vector<uint64_t> &marks) const;
+
 public:
 	/// @brief Parse a file into conditional rules and vectors of page numbers
 	/// @param input a file containing the conditional rules first in the form X|Y, then a one line break, then any number of lines
 	/// of comma separated integer values.
 	void parse_conditional_file(const string &input);
 
-	/// @brief Check each line of updates stored in all_updates and then sum the median of the correctly ordered lines
+	/// @brief Add the rule before|after, so `before` must be printed before `after` in every update containing both.
+	/// Throws invalid_argument if either page is negative or past MAX_PAGE.
+	/// @param before a page number
+	/// @param after a page number
+	void add_rule(int before, int after);
+
+	/// @brief Remove the rule before|after, if it exists
+	/// @param before a page number
+	/// @param after a page number
+	void remove_rule(int before, int after);
+
+	/// @brief Parse a batch of updates without touching the rules, so batches can be streamed in as they arrive
+	/// @param ss a sequence of lines of comma separated integer values
+	/// @return one update per line
+	static vector<update> parse_updates(ScanSequence &ss);
+
+	/// @brief Check each line of updates stored in all_updates and then sum the median of the correctly ordered lines.
+	/// Incorrect lines are only checked, never sorted, so call sum_medians instead when both sums are needed.
 	/// @return the sum of the medians of the correct update lines.
-	int get_center_sum_from_correct_updates() const;
+	int64_t get_center_sum_from_correct_updates() const;
+
+	/// @brief Check every update once and sum the medians of both the correct updates and the incorrect updates once
+	/// they are reordered, in one pass. Updates are split between threads, each reusing one page bitmask for every
+	/// update it checks.
+	/// @param correct_sum set to the sum of the medians of the correct update lines
+	/// @param incorrect_sum set to the sum of the medians of the incorrect update lines, once correctly sorted
+	/// @param threads The number of threads to use. Defaults to the hardware concurrency, and small batches use fewer threads.
+	void sum_medians(int64_t &correct_sum, int64_t &incorrect_sum, unsigned threads = 0) const;
+
+	/// @brief sum_medians for a batch of updates other than the ones stored in all_updates, under the current rules
+	void sum_medians(const vector<update> &updates, int64_t &correct_sum, int64_t &incorrect_sum, unsigned threads = 0) const;
 
 	/// @brief Checks an single line all_updates[update_idx] for valid ordering.
 	/// @param update_idx The index of the update line to check
 	/// @return True if correctly ordered.
 	bool check_update(int update_idx) const;
+	/// @brief Checks a single update that isn't stored in all_updates for valid ordering, under the current rules.
+	/// @param up The update to check
+	/// @return True if correctly ordered.
+	bool check_update(const update &up) const;
 	/// @brief Get each incorrectly ordered update, and sort it properly. Sum the medians of these updates.
-	/// Sorting is performed using the standard library sort function and custom comparison.
+	/// The median is found by find_median where it can be, and otherwise by sorting with sort_update.
+	/// Runs sum_medians, so call that instead when both sums are needed.
 	/// @return the integer sum of the medians of the now-correctly sorted (incorrect) update lines
-	int reorder_incorrect_sum_median() const;
-	/// @brief Sort an update line using the standard library sort algorithm and our (private) custom comparison function printBefore
+	int64_t reorder_incorrect_sum_median() const;
+	/// @brief Sort an update line so that it follows every rule between its pages, using reorder
 	/// @param up the update to sort
-	/// @return a copy of `up`, correctly sorted.
+	/// @return a copy of `up`, correctly sorted. Throws runtime_error naming the cycle if the rules between its pages form one.
 	update sort_update(const update &up) const;
+	/// @brief Reorder an update using Kahn's algorithm over the rules between its pages, which are held as bitsets
+	/// over the positions in the update. Only those rules are used, so the full rule set doesn't need to be a strict
+	/// weak ordering, and each pair of pages is looked up in the rule matrix once.
+	/// @param up the update to reorder
+	/// @param ordered set to the pages of `up` in an order that keeps every rule between them, or cleared if there is none
+	/// @param cycle set to the pages of one cycle of rules between the pages of `up`, in rule order, or cleared if there is none
+	/// @return True if `up` was reordered, false if the rules between its pages form a cycle
+	bool reorder(const update &up, update &ordered, pages &cycle) const;
+	/// @brief Find the page that would be in the middle of an update once it is correctly sorted, without sorting it.
+	/// A page with rules to exactly size - 1 - size / 2 other pages of the update, rules from exactly size / 2 of them, and
+	/// no page on both sides, is in the middle of every correct order. Each page's count of rules to other pages is taken
+	/// with a popcount of its rule matrix row against a bitmask of the update's pages, and only pages with the right count
+	/// get a bitmask of the pages before them. A cycle through the median page is left to sort_update to report, but a cycle
+	/// among the other pages isn't detected, so check with sort_update if that matters.
+	/// @param up the update to find the median of
+	/// @param median set to the median page, if it was found
+	/// @return True if the median was found. False if no page has a rule with every other page of the update, so finding
+	/// the median needs a sort, if the only such page is on both sides of another page, or if a page appears twice.
+	bool find_median(const update &up, int &median) const;
 
 	size_t num_updates() const { return all_updates.size(); };
 };
 
-void PrintOrdering::parse_conditional_file(const string &input)
+void PrintOrdering::build_rules(const vector<pair<int, int>> &rules)
 {
-	conditional_key_before_values.clear();
-	all_updates.clear();
+	rule_after.clear();
+	page_limit = 0;
+	rule_words = 0;
 
-	ifstream file(input);
-	string line;
-	while (getline(file, line) && line.size() != 0)
+	// Size the matrix for every rule up front, so it is only allocated once
+	int limit = 0;
+	for (auto rule : rules)
 	{
-		// Parse the pairs of conditions
-		size_t sep_pos = line.find_first_of('|');
-		int before = stoi(line.substr(0, sep_pos));
-		int after = stoi(line.substr(sep_pos + 1));
-		conditional_key_before_values[before].push_back(after);
+		check_rule_page(rule.first);
+		check_rule_page(rule.second);
+		limit = max(limit, max(rule.first, rule.second) + 1);
 	}
+	grow_rules(limit);
 
-	while (getline(file, line))
+	for (auto rule : rules)
 	{
-		// Parse the lists of pages to print
-		stringstream line_stream(line);
-		string page;
-		vector<int> these_pages;
-		while (getline(line_stream, page, ','))
+		add_rule(rule.first, rule.second);
+	}
+}
+
+void PrintOrdering::grow_rules(int limit)
+{
+	if (limit <= page_limit)
+		return;
+
+	int grown_limit = min(max(limit, page_limit * 2), MAX_PAGE + 1);
+	int grown_words = (grown_limit + 63) / 64;
+	vector<uint64_t> grown(size_t(grown_limit) * grown_words, 0);
+	for (int page = 0; page < page_limit; page++)
+	{
+		copy(pages_after(page), pages_after(page) + rule_words, &grown[size_t(page) * grown_words]);
+	}
+
+	rule_after.swap(grown);
+	page_limit = grown_limit;
+	rule_words = grown_words;
+}
+
+void PrintOrdering::check_rule_page(int page)
+{
+	if (page < 0)
+		throw invalid_argument("page numbers in rules can't be negative");
+	if (page > MAX_PAGE)
+		throw invalid_argument("page " + to_string(page) + " in a rule is past the largest page " + to_string(MAX_PAGE));
+}
+
+void PrintOrdering::add_rule(int before, int after)
+{
+	check_rule_page(before);
+	check_rule_page(after);
+	grow_rules(max(before, after) + 1);
+	rule_after[size_t(before) * rule_words + after / 64] |= uint64_t(1) << (after % 64);
+}
+
+void PrintOrdering::remove_rule(int before, int after)
+{
+	if (before < 0 || before >= page_limit || after < 0 || after >= page_limit)
+		return;
+	rule_after[size_t(before) * rule_words + after / 64] &= ~(uint64_t(1) << (after % 64));
+}
+
+vector<update> PrintOrdering::parse_updates(ScanSequence &ss)
+{
+	// Each line is independent, so parse them in parallel chunks
+	return ss.parseLinesChunked<update>([](ScanSequence &line)
+										{
+		update these_pages;
+		while (!line.isAtEnd())
 		{
-			these_pages.push_back(stoi(page));
+			// Stop at anything that isn't a page number, rather than adding a bogus page
+			int page;
+			if (!line.scanIntChecked(page))
+				break;
+			these_pages.push_back(page);
+			line.consumeString(',');
 		}
+		return these_pages; });
+}
 
-		all_updates.push_back(these_pages);
+void PrintOrdering::parse_conditional_file(const string &input)
+{
+	all_updates.clear();
+
+	vector<pair<int, int>> rules;
+	ScanSequence ss(input, true);
+	while (!ss.isAtEnd() && ss.peekAtChar() != '\n' && ss.peekAtChar() != '\r')
+	{
+		// Parse the pairs of conditions, stopping at anything that isn't one
+		int before, after;
+		if (!ss.scanIntChecked(before) || !ss.consumeString('|') || !ss.scanIntChecked(after))
+			break;
+		ss.consumeString('\r');
+		ss.consumeString('\n');
+		rules.push_back({before, after});
 	}
+	ss.consumeWhitespace();
+	build_rules(rules);
 
-	file.close();
+	// Parse the lists of pages to print
+	all_updates = parse_updates(ss);
 }
 
 bool PrintOrdering::check_update(int update_idx) const
 {
-	const update &up = all_updates[update_idx];
-	unordered_map<int, int> page_to_position;
+	return check_update(all_updates[update_idx]);
+}
 
-	// Iterate through every page in this update in order, recording the position each page appears at
-	for (int i = 0; i < up.size(); i++)
-	{
-		int page = up[i];
-		page_to_position[page] = i;
+bool PrintOrdering::check_update(const update &up) const
+{
+	vector<uint64_t> marks(rule_words, 0);
+	return check_pages(up, marks);
+}
 
-		// Check if there are any conditions on this page value
-		if (!conditional_key_before_values.count(page))
+bool PrintOrdering::check_pages(const update &up, vector<uint64_t> &marks) const
+{
+	// Iterate through every page in this update in order, recording each page in the bitmask as it is seen.
+	// A page is out of order if any page that must be printed after it has already been seen.
+	// Pages past page_limit aren't part of any rule, so they can't break one
+	bool ordered = true;
+	size_t seen = 0;
+	for (; seen < up.size() && ordered; seen++)
+	{
+		int page = up[seen];
+		if (page < 0 || page >= page_limit)
 			continue;
-		// Iterate through our stored conditions and check every page that is required to be after the current page
-		// Check if the 'after' pages have been seen before, and if they've appeared before the current page
-		for (auto page_after : conditional_key_before_values.at(page))
+
+		const uint64_t *after = pages_after(page);
+		for (int w = 0; w < rule_words; w++)
 		{
-			if (page_to_position.count(page_after) && page_to_position.at(page_after) < i)
-			{
-				return false;
-			}
+			if (after[w] & marks[w])
+				ordered = false;
 		}
+		marks[page / 64] |= uint64_t(1) << (page % 64);
 	}
 
-	return true;
+	// Clear only the pages that were marked, so the cost stays proportional to the update
+	for (size_t i = 0; i < seen; i++)
+	{
+		if (up[i] >= 0 && up[i] < page_limit)
+			marks[up[i] / 64] = 0;
+	}
+	return ordered;
 }
 
-int PrintOrdering::get_center_sum_from_correct_updates() const
+int64_t PrintOrdering::get_center_sum_from_correct_updates() const
 {
-	int sum = 0;
-	for (int i = 0; i < num_updates(); i++)
+	// Only check each update, so incorrect updates are never sorted, and rules that form a cycle between their pages
+	// can't make this throw
+	unsigned threads = threadCount(all_updates.size(), MIN_UPDATES_PER_THREAD);
+	vector<int64_t> correct(threads, 0);
+	parallelRanges(all_updates.size(), threads, [&](unsigned t, size_t begin, size_t end)
+				   {
+		vector<uint64_t> marks(rule_words, 0);
+		for (size_t i = begin; i < end; i++)
+		{
+			const update &up = all_updates[i];
+			if (!up.empty() && check_pages(up, marks))
+				correct[t] += up[up.size() / 2];
+		} });
+
+	int64_t correct_sum = 0;
+	for (int64_t sum : correct)
 	{
-		if (check_update(i))
+		correct_sum += sum;
+	}
+	return correct_sum;
+}
+
+void PrintOrdering::sum_medians(int64_t &correct_sum, int64_t &incorrect_sum, unsigned threads) const
+{
+	sum_medians(all_updates, correct_sum, incorrect_sum, threads);
+}
+
+void PrintOrdering::sum_medians(const vector<update> &updates, int64_t &correct_sum, int64_t &incorrect_sum, unsigned threads) const
+{
+	threads = threadCount(updates.size(), MIN_UPDATES_PER_THREAD, threads);
+	vector<int64_t> correct(threads, 0), incorrect(threads, 0);
+	parallelRanges(updates.size(), threads, [&](unsigned t, size_t begin, size_t end)
+				   {
+		vector<uint64_t> marks(rule_words, 0);
+		for (size_t i = begin; i < end; i++)
 		{
-			sum += all_updates[i][all_updates[i].size() / 2];
-		}
+			const update &up = updates[i];
+			if (up.empty())
+				continue;
+			if (check_pages(up, marks))
+			{
+				correct[t] += up[up.size() / 2];
+				continue;
+			}
+
+			int median;
+			if (!find_median(up, median, marks))
+			{
+				update sorted = sort_update(up);
+				median = sorted[sorted.size() / 2];
+			}
+			incorrect[t] += median;
+		} });
+
+	correct_sum = incorrect_sum = 0;
+	for (unsigned t = 0; t < threads; t++)
+	{
+		correct_sum += correct[t];
+		incorrect_sum += incorrect[t];
 	}
-	return sum;
 }
 
 bool PrintOrdering::printBefore(int lhs, int rhs) const
 {
-	if (!conditional_key_before_values.count(lhs))
+	if (lhs < 0 || lhs >= page_limit || rhs < 0 || rhs >= page_limit)
 		return false;
-	vector<int> afters = conditional_key_before_values.at(lhs);
-	return count(afters.begin(), afters.end(), rhs);
+	return (pages_after(lhs)[rhs / 64] >> (rhs % 64)) & 1;
 }
 
 update PrintOrdering::sort_update(const update &up) const
 {
-	update copied(up);
-	sort(copied.begin(), copied.end(), [*this](const int &lhs, const int &rhs)
-		 { return this->printBefore(lhs, rhs); });
-	return copied;
+	update ordered;
+	pages cycle;
+	if (!reorder(up, ordered, cycle))
+	{
+		stringstream message;
+		message << "rules form a cycle: ";
+		for (int page : cycle)
+		{
+			message << page << '|';
+		}
+		message << cycle[0];
+		throw runtime_error(message.str());
+	}
+	return ordered;
+}
+
+bool PrintOrdering::reorder(const update &up, update &ordered, pages &cycle) const
+{
+	int n = up.size();
+	int words = (n + 63) / 64;
+	ordered.clear();
+	cycle.clear();
+
+	// Row i of 'after' and 'before' has a bit set for each position whose page must be printed after or before up[i]
+	vector<uint64_t> after(size_t(n) * words, 0), before(size_t(n) * words, 0);
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			if (i != j && printBefore(up[i], up[j]))
+			{
+				after[size_t(i) * words + j / 64] |= uint64_t(1) << (j % 64);
+				before[size_t(j) * words + i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+	// Start from every page with nothing to be printed before it
+	vector<int> in_degree(n, 0);
+	vector<int> ready;
+	for (int i = 0; i < n; i++)
+	{
+		for (int w = 0; w < words; w++)
+		{
+			in_degree[i] += __builtin_popcountll(before[size_t(i) * words + w]);
+		}
+		if (!in_degree[i])
+			ready.push_back(i);
+	}
+
+	// Print each ready page, and then any page whose last page to print before it was this one
+	for (size_t head = 0; head < ready.size(); head++)
+	{
+		int i = ready[head];
+		ordered.push_back(up[i]);
+		for (int w = 0; w < words; w++)
+		{
+			for (uint64_t bits = after[size_t(i) * words + w]; bits; bits &= bits - 1)
+			{
+				int j = w * 64 + __builtin_ctzll(bits);
+				if (!--in_degree[j])
+					ready.push_back(j);
+			}
+		}
+	}
+	if (ordered.size() == up.size())
+		return true;
+
+	// Every page left has a page before it that is also left, so following those back from any of them must loop
+	vector<uint64_t> left(words, 0);
+	int start = -1;
+	for (int i = 0; i < n; i++)
+	{
+		if (in_degree[i])
+		{
+			left[i / 64] |= uint64_t(1) << (i % 64);
+			start = i;
+		}
+	}
+
+	vector<int> path;
+	vector<int> path_index(n, -1);
+	int i = start;
+	while (path_index[i] < 0)
+	{
+		path_index[i] = path.size();
+		path.push_back(i);
+		for (int w = 0; w < words; w++)
+		{
+			uint64_t bits = before[size_t(i) * words + w] & left[w];
+			if (bits)
+			{
+				i = w * 64 + __builtin_ctzll(bits);
+				break;
+			}
+		}
+	}
+
+	// The path loops back to i, walking the rules backwards
+	for (int k = path.size() - 1; k >= path_index[i]; k--)
+	{
+		cycle.push_back(up[path[k]]);
+	}
+	ordered.clear();
+	return false;
 }
 
-int PrintOrdering::reorder_incorrect_sum_median() const
+bool PrintOrdering::find_median(const update &up, int &median) const
 {
-	int sum = 0;
-	for (int i = 0; i < num_updates(); i++)
+	vector<uint64_t> marks(rule_words, 0);
+	return find_median(up, median, marks);
+}
+
+bool PrintOrdering::find_median(const update &up, int &median, vector<uint64_t> &marks) const
+{
+	int n = up.size();
+
+	// Mark the pages in the update. Pages past page_limit aren't part of any rule, so they have no rules to count
+	bool repeated = false;
+	for (int page : up)
+	{
+		if (page < 0 || page >= page_limit)
+			continue;
+		uint64_t bit = uint64_t(1) << (page % 64);
+		repeated |= (marks[page / 64] & bit) != 0;
+		marks[page / 64] |= bit;
+	}
+
+	// A page with n - 1 - n / 2 rules to other pages after it, n / 2 rules from other pages before it, and no page on
+	// both sides is ordered against every other page in the update, so it is in the middle of every correct order.
+	// Only one page can be, so stop at the first
+	int target_after = n - 1 - n / 2;
+	vector<uint64_t> before(rule_words, 0);
+	bool found = false;
+	for (int page : up)
 	{
-		if (!check_update(i))
+		if (repeated)
+			break;
+
+		// A rule page|page doesn't put the page after itself
+		bool in_rules = page >= 0 && page < page_limit;
+		int num_after = 0;
+		if (in_rules)
+		{
+			const uint64_t *after = pages_after(page);
+			for (int w = 0; w < rule_words; w++)
+			{
+				num_after += __builtin_popcountll(after[w] & marks[w]);
+			}
+			num_after -= printBefore(page, page);
+		}
+		if (num_after != target_after)
+			continue;
+
+		// Only the few pages that pass the first test get a mask of the other pages before them
+		int num_before = 0;
+		for (int other : up)
 		{
-			update sorted = sort_update(all_updates[i]);
-			sum += sorted[sorted.size() / 2];
+			if (other != page && printBefore(other, page))
+			{
+				before[other / 64] |= uint64_t(1) << (other % 64);
+				num_before++;
+			}
+		}
+
+		// A page both before and after this one means the rules between them form a cycle, which sort_update reports
+		bool both_sides = false;
+		if (in_rules)
+		{
+			const uint64_t *after = pages_after(page);
+			for (int w = 0; w < rule_words; w++)
+			{
+				both_sides |= (after[w] & before[w]) != 0;
+			}
+		}
+		for (int other : up)
+		{
+			if (other >= 0 && other < page_limit)
+				before[other / 64] = 0;
+		}
+
+		if (!both_sides && num_after + num_before == n - 1)
+		{
+			median = page;
+			found = true;
+			break;
 		}
 	}
-	return sum;
+
+	for (int page : up)
+	{
+		if (page >= 0 && page < page_limit)
+			marks[page / 64] = 0;
+	}
+	return found;
+}
+
+int64_t PrintOrdering::reorder_incorrect_sum_median() const
+{
+	int64_t correct_sum, incorrect_sum;
+	sum_medians(correct_sum, incorrect_sum);
+	return incorrect_sum;
 }
 
 int main()
@@ -163,6 +576,9 @@ int main()
 
 	PrintOrdering po;
 	po.parse_conditional_file(input);
-	cout << "Sum of middle of correct updates: " << po.get_center_sum_from_correct_updates() << endl;
-	cout << "Sum of middle of incorrect updates resorted to be corred: " << po.reorder_incorrect_sum_median() << endl;
+	int64_t correct_sum, incorrect_sum;
+	po.sum_medians(correct_sum, incorrect_sum);
+	cout << "Sum of middle of correct updates: " << correct_sum << endl;
+	cout << "Sum of middle of incorrect updates resorted to be corred: " << incorrect_sum << endl;
+	return 0;
 }
\ No newline at end of file
@@ -3,12 +3,11 @@
 #include <utility>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
-using namespace std;
+#include "../grid.h"
 
-// each direction is (row, col)
-vector<pair<int, int>> coord_directions = {
-	{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+using namespace std;
 
 enum direction
 {
@@ -25,92 +24,196 @@ struct guard
 	direction dir;
 };
 
-/// @brief Read a grid from file into a 2d vector
+/// @brief Read a grid from file into a Grid
 /// @param filename file path
 /// @param start_symbol the symbol indicating the position of the guard
 /// @param out_guard a struct to update with guard position and facing
-/// @return the 2d grid representing the room
-vector<vector<char>> read_single_char_grid(const string &filename, char start_symbol, guard &out_guard)
+/// @return the grid representing the room
+Grid<char> read_single_char_grid(const string &filename, char start_symbol, guard &out_guard)
+{
+	ScanSequence ss(filename, true);
+	return Grid<char>::load(ss, [&](char c, int row, int col)
+							{
+		if (c == start_symbol)
+		{
+			out_guard.r = row;
+			out_guard.c = col;
+			out_guard.dir = UP;
+		}
+		return c; });
+}
+
+/// @brief The obstacles in a room, listed per row and per column in increasing order,
+/// so the next obstacle in any direction from a cell can be found with a binary search.
+/// The lists only hold the obstacles, so they stay small for large, sparse rooms.
+struct obstacle_index
 {
-	ifstream file(filename);
-	vector<vector<char>> grid;
+	int rows;
+	int cols;
+	size_t num_obstacles;
 
-	string line;
-	int row = 0;
-	while (getline(file, line))
+	// cols_in_row[r] holds the column of every obstacle in row r, and rows_in_col[c] the row of every obstacle in column c
+	vector<vector<int>> cols_in_row;
+	vector<vector<int>> rows_in_col;
+};
+
+/// @brief A straight run of cells the guard walked, from `from` to `to` inclusive along row or column `line`
+struct segment
+{
+	int line;
+	int from;
+	int to;
+};
+
+/// @brief Build the obstacle lists for a room
+/// @param grid the grid read from the file
+/// @return the obstacles in every row and column
+obstacle_index index_obstacles(const Grid<char> &grid)
+{
+	obstacle_index index = {grid.numRows(), grid.numCols(), 0, vector<vector<int>>(grid.numRows()), vector<vector<int>>(grid.numCols())};
+	// Scanning in row order leaves both lists sorted
+	for (int r = 0; r < grid.numRows(); r++)
 	{
-		grid.push_back({});
-		for (int col = 0; col < line.size(); col++)
+		const char *row = grid.rowData(r);
+		for (int c = 0; c < grid.numCols(); c++)
 		{
-			grid.back().push_back(line[col]);
-			if (line[col] == start_symbol)
+			if (row[c] == '#')
 			{
-				out_guard.r = row;
-				out_guard.c = col;
-				out_guard.dir = UP;
+				index.cols_in_row[r].push_back(c);
+				index.rows_in_col[c].push_back(r);
+				index.num_obstacles++;
 			}
 		}
-		row++;
 	}
-
-	file.close();
-	return grid;
+	return index;
 }
 
-/// @brief Get a pair of the next position the guard will move to. Convenience func
-/// @param g guard struct
-/// @return a pair of the new values.
-pair<int, int> get_next_position(const guard &g)
+/// @brief Move the guard straight to the cell before the next obstacle it faces, and turn it 90 clockwise.
+/// The run of cells walked, including the one the guard started on, is added to the horizontal or vertical segments.
+/// @param out_guard reference to the guard struct, to update
+/// @param index the obstacles in the room
+/// @param horizontal the runs walked along rows
+/// @param vertical the runs walked along columns
+/// @return true if the guard turned, false if it walked out of the room.
+bool jump_guard(guard &out_guard, const obstacle_index &index, vector<segment> &horizontal, vector<segment> &vertical)
 {
-	auto dir = coord_directions[g.dir];
-	return {dir.first + g.r, dir.second + g.c};
+	bool along_row = out_guard.dir == LEFT || out_guard.dir == RIGHT;
+	const vector<int> &obstacles = along_row ? index.cols_in_row[out_guard.r] : index.rows_in_col[out_guard.c];
+	int &pos = along_row ? out_guard.c : out_guard.r;
+	int line = along_row ? out_guard.r : out_guard.c;
+	int limit = along_row ? index.cols : index.rows;
+	int start = pos;
+
+	// Find the first obstacle ahead, or walk off the edge if there isn't one
+	bool blocked;
+	if (out_guard.dir == DOWN || out_guard.dir == RIGHT)
+	{
+		auto next = upper_bound(obstacles.begin(), obstacles.end(), pos);
+		blocked = next != obstacles.end();
+		pos = blocked ? *next - 1 : limit - 1;
+	}
+	else
+	{
+		auto next = lower_bound(obstacles.begin(), obstacles.end(), pos);
+		blocked = next != obstacles.begin();
+		pos = blocked ? *(next - 1) + 1 : 0;
+	}
+
+	(along_row ? horizontal : vertical).push_back({line, min(start, pos), max(start, pos)});
+	if (blocked)
+		out_guard.dir = direction((out_guard.dir + 1) % 4);
+	return blocked;
 }
 
-/// @brief Update the position of the passed-by-reference guard struct, using the grid to check if we've left the room.
-/// If the space to move into is a # char, we must rotate 90 clockwise until we have a free movement
-/// @param out_guard reference to the guard struct, to update
-/// @param grid grid object
-/// @return true if we can continue moving, false if we've left the grid.
-bool update_guard_position(guard &out_guard, const vector<vector<char>> &grid)
+/// @brief Merge segments that overlap along the same line, and count the cells they cover
+/// @param segments the segments to merge, which are sorted and merged in place
+/// @return the number of cells covered
+long long merge_segments(vector<segment> &segments)
 {
-	// Check if the next position is a collision position
-	auto next_pos = get_next_position(out_guard);
-	if (next_pos.first < 0 || next_pos.first >= grid.size() || next_pos.second < 0 || next_pos.second >= grid[0].size())
+	sort(segments.begin(), segments.end(), [](const segment &a, const segment &b)
+		 { return a.line != b.line ? a.line < b.line : a.from < b.from; });
+
+	vector<segment> merged;
+	long long cells = 0;
+	for (const segment &seg : segments)
 	{
-		return false;
+		if (!merged.empty() && merged.back().line == seg.line && seg.from <= merged.back().to)
+		{
+			cells += max(0, seg.to - merged.back().to);
+			merged.back().to = max(merged.back().to, seg.to);
+			continue;
+		}
+		merged.push_back(seg);
+		cells += seg.to - seg.from + 1;
 	}
+	segments.swap(merged);
+	return cells;
+}
 
-	while (grid[next_pos.first][next_pos.second] == '#')
+/// @brief Count the cells covered by a set of horizontal and vertical segments. The segments of each kind are merged,
+/// then the cells both kinds cover are counted by sweeping down the rows, keeping the columns covered by a
+/// vertical segment in a Fenwick tree and querying it for each horizontal segment.
+/// @param horizontal the runs walked along rows
+/// @param vertical the runs walked along columns
+/// @param cols the number of columns in the room
+/// @return the number of unique cells covered
+long long count_covered(vector<segment> horizontal, vector<segment> vertical, int cols)
+{
+	long long covered = merge_segments(horizontal) + merge_segments(vertical);
+
+	vector<segment> by_end(vertical);
+	sort(vertical.begin(), vertical.end(), [](const segment &a, const segment &b)
+		 { return a.from < b.from; });
+	sort(by_end.begin(), by_end.end(), [](const segment &a, const segment &b)
+		 { return a.to < b.to; });
+
+	vector<int> tree(cols + 1, 0);
+	auto add = [&](int col, int delta)
 	{
-		// Rotate the guard by 90deg. Continue moving
-		out_guard.dir = direction((out_guard.dir + 1) % 4);
-		next_pos = get_next_position(out_guard);
+		for (int i = col + 1; i <= cols; i += i & -i)
+			tree[i] += delta;
+	};
+	auto prefix = [&](int col)
+	{
+		int sum = 0;
+		for (int i = col + 1; i > 0; i -= i & -i)
+			sum += tree[i];
+		return sum;
+	};
+
+	// Merged vertical segments never overlap, so each column is covered by at most one at a time
+	size_t next_start = 0, next_end = 0;
+	for (const segment &seg : horizontal)
+	{
+		for (; next_start < vertical.size() && vertical[next_start].from <= seg.line; next_start++)
+			add(vertical[next_start].line, 1);
+		for (; next_end < by_end.size() && by_end[next_end].to < seg.line; next_end++)
+			add(by_end[next_end].line, -1);
+		covered -= prefix(seg.to) - prefix(seg.from - 1);
 	}
-	out_guard.r = next_pos.first;
-	out_guard.c = next_pos.second;
-	return true;
+	return covered;
 }
 
-/// @brief Iterate through the guards positions, maintaining the visited positions as a second grid
-/// to check every movement so we can skip counting duplicate spaces visisted.
+/// @brief Follow the guard from turn to turn, jumping straight along each run between obstacles rather than stepping
+/// one cell at a time, so the walk costs O(turns) lookups however far apart the obstacles are. The runs walked are
+/// kept as segments and the unique cells visited are counted from those, so no visited grid is needed.
 /// @param g the guard struct, with initial position and direction set from the file read
 /// @param grid the grid read from the file
-/// @return the number of unique cells visited
-int follow_guard_count_unique(guard g, const vector<vector<char>> &grid)
+/// @return the number of unique cells visited, or -1 if the guard never leaves the room
+long long follow_guard_count_unique(guard g, const Grid<char> &grid)
 {
-	vector<vector<bool>> visited(grid.size(), vector<bool>(grid[0].size(), false));
-	visited[g.r][g.c] = true;
-	int vc = 1;
-	// Update the guard's position one step until it leaves the grid
-	while (update_guard_position(g, grid))
+	obstacle_index index = index_obstacles(grid);
+	vector<segment> horizontal, vertical;
+
+	// Each turn is at one side of one obstacle. If any of those happens twice the guard is going round in a loop
+	size_t max_turns = 4 * index.num_obstacles;
+	size_t turns = 0;
+	while (jump_guard(g, index, horizontal, vertical))
 	{
-		if (!visited[g.r][g.c])
-		{
-			vc++;
-			visited[g.r][g.c] = true;
-		}
+		if (++turns > max_turns)
+			return -1;
 	}
-	return vc;
+	return count_covered(horizontal, vertical, index.cols);
 }
 
 int main()
@@ -119,7 +222,7 @@ int main()
 	guard g;
 	auto grid = read_single_char_grid(input, '^', g);
 
-	int unique_visited = follow_guard_count_unique(g, grid);
+	long long unique_visited = follow_guard_count_unique(g, grid);
 	cout << "Number of unique cells visited: " << unique_visited << endl;
 
 	return 0;
@@ -4,6 +4,8 @@
 #include <fstream>
 #include <sstream>
 
+#include "../scanner.h"
+
 using namespace std;
 
 class Calibrations
@@ -45,25 +47,34 @@ void Calibrations::parse_calibrations(const string &filename)
 {
 	test_values.clear();
 	equations.clear();
-	ifstream file(filename);
-	string line;
 
-	while (getline(file, line))
-	{
-		stringstream eq(line);
-		// Get the test value from the full equation string stream
-		getline(eq, line, ':');
-
-		test_values.push_back(stoll(line));
-		equations.push_back({});
-		// Get the list of operands from the rest of the string stream
-		while (getline(eq, line, ' '))
+	// Each equation is an independent line, so parse them in parallel chunks
+	ScanSequence ss(filename, true);
+	vector<pair<long long, vector<long long>>> parsed = ss.parseLinesChunked<pair<long long, vector<long long>>>([](ScanSequence &line)
+																												 {
+		pair<long long, vector<long long>> eq;
+		// Get the test value, then the list of operands from the rest of the line
+		eq.first = line.scanInt64();
+		line.consumeString(':');
+		line.consumeWhitespace();
+		while (!line.isAtEnd())
 		{
-			if (line.size())
-				equations.back().push_back(stoll(line));
+			// Stop at anything that isn't an operand
+			int64_t operand;
+			if (!line.scanInt64Checked(operand))
+				break;
+			eq.second.push_back(operand);
+			line.consumeWhitespace();
 		}
+		return eq; });
+
+	test_values.reserve(parsed.size());
+	equations.reserve(parsed.size());
+	for (auto &eq : parsed)
+	{
+		test_values.push_back(eq.first);
+		equations.push_back(std::move(eq.second));
 	}
-	file.close();
 }
 
 bool Calibrations::can_make_true_using_add_multiply(int eq_idx) const
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include "../grid.h"
+
+using namespace std;
+
+// Benchmark of cell lookups in Grid<int> against the vector<vector<int>> it replaced, in
+// lookups/second. A square map of random heights is generated, 2000 wide unless a size is given,
+// and read three ways: a row-major sweep, the orthogonal neighbours of every cell (bounds checked
+// for vector<vector>, read straight from a padded Grid), and a chain of random lookups.
+// Build with: g++ -std=c++17 -O2 bench-grid.cpp -o bench-grid
+
+const int BORDER_HEIGHT = -10;
+const int REPS = 10;
+
+// Time 'run' over REPS passes, where each pass makes 'lookups' lookups and returns a checksum
+template <typename F>
+void bench(const string &name, long long lookups, F run)
+{
+    auto start = chrono::steady_clock::now();
+    long long checksum = 0;
+    for (int r = 0; r < REPS; r++)
+    {
+        checksum += run();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "  " << name << ": " << lookups * REPS / seconds / 1e6 << " M lookups/s (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    int size = argc > 1 ? atoi(argv[1]) : 2000;
+    long long cells = (long long)size * size;
+
+    mt19937 rng(10);
+    vector<vector<int>> nested(size, vector<int>(size));
+    Grid<int> grid(size, size, 0, 1, BORDER_HEIGHT);
+    for (int r = 0; r < size; r++)
+    {
+        for (int c = 0; c < size; c++)
+        {
+            nested[r][c] = grid.at(r, c) = rng() % 10;
+        }
+    }
+
+    // Random lookups follow a chain, each position depending on the last cell read,
+    // so the loads can't be overlapped
+    vector<pair<int, int>> steps(1 << 16);
+    for (auto &step : steps)
+    {
+        step = {int(rng() % size), int(rng() % size)};
+    }
+
+    cout << "row-major sweep" << endl;
+    bench("vector<vector<int>>", cells, [&]()
+          {
+        long long sum = 0;
+        for (int r = 0; r < size; r++)
+            for (int c = 0; c < size; c++)
+                sum += nested[r][c];
+        return sum; });
+    bench("Grid<int>", cells, [&]()
+          {
+        long long sum = 0;
+        for (int r = 0; r < size; r++)
+            for (int c = 0; c < size; c++)
+                sum += grid.at(r, c);
+        return sum; });
+
+    cout << "orthogonal neighbours" << endl;
+    const int dirs[4][2] = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+    bench("vector<vector<int>>", cells * 4, [&]()
+          {
+        long long sum = 0;
+        for (int r = 0; r < size; r++)
+            for (int c = 0; c < size; c++)
+                for (const auto &d : dirs)
+                {
+                    int nr = r + d[0], nc = c + d[1];
+                    sum += nr >= 0 && nr < size && nc >= 0 && nc < size ? nested[nr][nc] : BORDER_HEIGHT;
+                }
+        return sum; });
+    bench("Grid<int>", cells * 4, [&]()
+          {
+        long long sum = 0;
+        for (int r = 0; r < size; r++)
+            for (int c = 0; c < size; c++)
+                for (const auto &d : dirs)
+                    sum += grid.at(r + d[0], c + d[1]);
+        return sum; });
+
+    cout << "random lookups" << endl;
+    bench("vector<vector<int>>", cells, [&]()
+          {
+        long long sum = 0;
+        int last = 0;
+        for (long long i = 0; i < cells; i++)
+        {
+            const auto &step = steps[(i + last) & (steps.size() - 1)];
+            last = nested[step.first][step.second];
+            sum += last;
+        }
+        return sum; });
+    bench("Grid<int>", cells, [&]()
+          {
+        long long sum = 0;
+        int last = 0;
+        for (long long i = 0; i < cells; i++)
+        {
+            const auto &step = steps[(i + last) & (steps.size() - 1)];
+            last = grid.at(step.first, step.second);
+            sum += last;
+        }
+        return sum; });
+    return 0;
+}
@@ -5,70 +5,54 @@
 #include <stack>
 #include <set>
 #include <numeric>
+
+#include "../grid.h"
+
 using namespace std;
 
 typedef pair<int, int> Vec2;
 
-vector<Vec2> get_orthagonal_adjecent(const Vec2 &v)
-{
-    return {
-        {v.first - 1, v.second}, {v.first + 1, v.second}, {v.first, v.second - 1}, {v.first, v.second + 1}};
-}
+// Height of the border around the map. It's never one more than any height, so it's never accessible
+const int BORDER_HEIGHT = -10;
 
-class Grid
+class TopoMap
 {
 private:
-    vector<vector<int>> grid;
+    Grid<int> grid;
     vector<Vec2> heads;
-    int rows, cols;
-    bool in_bounds(const Vec2 &pos) const
-    {
-        return pos.first >= 0 && pos.first < cols && pos.second >= 0 && pos.second < rows;
-    }
-    bool in_bounds_and_accessible(const Vec2 &pos, int cur_height) const
+    bool accessible(const Vec2 &pos, int cur_height) const
     {
-        return in_bounds(pos) && (at(pos) - cur_height == 1);
+        return at(pos) - cur_height == 1;
     }
     int at(const Vec2 &pos) const
     {
-        return grid[pos.second][pos.first];
+        return grid.at(pos.second, pos.first);
     }
     int at(int x, int y) const
     {
-        return grid[y][x];
+        return grid.at(y, x);
     }
 
 public:
     void parse_file(const string &path)
     {
-        ifstream file(path);
-        string line;
-        int row = 0, col = 0;
-        while (getline(file, line))
-        {
-            cols = line.size();
-            grid.push_back({});
-            for (int col = 0; col < line.size(); col++)
+        ScanSequence ss(path, true);
+        grid = Grid<int>::load(ss, [this](char c, int row, int col)
+                               {
+            if (c == '0')
             {
-                grid.back().push_back(line[col] - '0');
-                if (line[col] == '0')
-                {
-                    heads.push_back({col, row});
-                }
+                heads.push_back({col, row});
             }
-            row++;
-        }
-        rows = row;
-        file.close();
+            return c - '0'; }, 1, BORDER_HEIGHT);
     }
 
     void print_grid() const
     {
-        for (int i = 0; i < grid.size(); i++)
+        for (int i = 0; i < grid.numRows(); i++)
         {
-            for (int j = 0; j < grid[i].size(); j++)
+            for (int j = 0; j < grid.numCols(); j++)
             {
-                cout << grid[i][j];
+                cout << grid.at(i, j);
             }
             cout << endl;
         }
@@ -89,14 +73,14 @@ public:
                 summits++;
                 continue;
             }
-            for (auto next : get_orthagonal_adjecent(cur))
-            {
-                if (in_bounds_and_accessible(next, at(cur)) && explored.count(next) == 0)
+            grid.forEachOrthogonal(cur.second, cur.first, [&](int row, int col)
+                                   {
+                Vec2 next = {col, row};
+                if (accessible(next, at(cur)) && explored.count(next) == 0)
                 {
                     boundary.push(next);
                     explored.insert(next);
-                }
-            }
+                } });
         }
 
         return summits;
@@ -112,7 +96,7 @@ public:
 int main()
 {
     string input = "input.txt";
-    Grid g;
+    TopoMap g;
     g.parse_file(input);
     cout << "The sum of all trailhead scores is: " << g.score_all_trails() << endl;
 }
\ No newline at end of file
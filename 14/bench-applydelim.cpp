@@ -0,0 +1,93 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <cstdlib>
+
+#include "../scanner.h"
+
+using namespace std;
+
+// Benchmark of parsing robots through ScanSequence::applyWithDelim, in records/second, comparing the
+// templated overload that can inline the per-record lambda against the std::function overload.
+// The robots are generated in memory in the day 14 format, 10M of them unless a count is given.
+// Build with: g++ -std=c++17 -O2 bench-applydelim.cpp -o bench-applydelim
+
+typedef struct
+{
+    int x;
+    int y;
+} Vec2;
+
+typedef struct
+{
+    Vec2 pos;
+    Vec2 vel;
+} Robot;
+
+string generate_robots(size_t count)
+{
+    mt19937 rng(14);
+    string text;
+    text.reserve(count * 20);
+    for (size_t i = 0; i < count; i++)
+    {
+        text += "p=" + to_string(rng() % 101) + "," + to_string(rng() % 103);
+        text += " v=" + to_string(int(rng() % 201) - 100) + "," + to_string(int(rng() % 201) - 100) + "\n";
+    }
+    return text;
+}
+
+// Parse one robot, as parse_robots does
+void parse_robot(ScanSequence &ss, vector<Robot> &robots)
+{
+    ss.consumeString("p=");
+    int x = ss.scanInt();
+    ss.consumeString(",");
+    int y = ss.scanInt();
+    ss.skipUntilPast('=');
+    int vX = ss.scanInt();
+    ss.consumeString(",");
+    int vY = ss.scanInt();
+    robots.push_back(Robot{{x, y}, {vX, vY}});
+}
+
+// Time 'parse' over the whole text, and report records/second
+template <typename F>
+void bench(const string &name, const string &text, size_t count, F parse)
+{
+    ScanSequence ss(text);
+    vector<Robot> robots;
+    robots.reserve(count);
+
+    auto start = chrono::steady_clock::now();
+    parse(ss, robots);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    long long checksum = 0;
+    for (const Robot &robot : robots)
+    {
+        checksum += robot.pos.x + robot.pos.y + robot.vel.x + robot.vel.y;
+    }
+    cout << name << ": " << robots.size() / seconds / 1e6 << " M records/s (" << robots.size()
+         << " robots, checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+    string text = generate_robots(count);
+
+    bench("std::function", text, count, [](ScanSequence &ss, vector<Robot> &robots)
+          {
+        function<void(ScanSequence &)> apply = [&robots](ScanSequence &line)
+        { parse_robot(line, robots); };
+        ss.applyWithDelim('\n', apply); });
+
+    bench("template", text, count, [](ScanSequence &ss, vector<Robot> &robots)
+          { ss.applyWithDelim('\n', [&robots](ScanSequence &line)
+                              { parse_robot(line, robots); }); });
+    return 0;
+}
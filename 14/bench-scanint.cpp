@@ -0,0 +1,98 @@
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+
+#include "../scanner.h"
+
+using namespace std;
+
+// Micro-benchmark of the integer scanners, in ints/second over the day 14 and day 18 inputs.
+// Every number in the input is scanned, skipping the chars between them. The old scanInt, which
+// built a stringstream per number and called stoi, is kept here as the baseline.
+// Build with: g++ -std=c++17 -O2 bench-scanint.cpp -o bench-scanint
+
+// Scan an int the way ScanSequence::scanInt used to
+int scanIntStringstream(ScanSequence &ss)
+{
+	stringstream digits;
+	ss.consumeWhitespace();
+	if (!ss.isAtEnd() && ss.peekAtChar() == '-')
+	{
+		digits << ss.scanChar();
+	}
+	while (!ss.isAtEnd() && isDigit(ss.peekAtChar()))
+	{
+		digits << ss.scanChar();
+	}
+	return stoi(digits.str());
+}
+
+string readFile(const string &filename)
+{
+	ifstream file(filename);
+	stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+// Scan every number in 'text' with 'scan', 'reps' times over. Returns the sum of the numbers,
+// so the work can't be optimised away, and sets 'count' to how many numbers were scanned
+template <typename F>
+long long scanAll(const string &text, int reps, long long &count, F scan)
+{
+	long long sum = 0;
+	count = 0;
+	for (int r = 0; r < reps; r++)
+	{
+		ScanSequence ss(text);
+		while (!ss.isAtEnd())
+		{
+			char c = ss.peekAtChar();
+			if (isDigit(c) || c == '-')
+			{
+				sum += scan(ss);
+				count++;
+			}
+			else
+			{
+				ss.scanChar();
+			}
+		}
+	}
+	return sum;
+}
+
+template <typename F>
+void bench(const string &name, const string &text, F scan)
+{
+	const int REPS = 2000;
+
+	auto start = chrono::steady_clock::now();
+	long long count;
+	long long sum = scanAll(text, REPS, count, scan);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << "  " << name << ": " << count / seconds / 1e6 << " M ints/s (checksum " << sum << ")" << endl;
+}
+
+int main()
+{
+	for (string filename : {"input.txt", "../18/input.txt"})
+	{
+		string text = readFile(filename);
+		cout << filename << endl;
+		bench("stringstream + stoi", text, scanIntStringstream);
+		bench("scanInt", text, [](ScanSequence &ss)
+			  { return ss.scanInt(); });
+		bench("scanInt64", text, [](ScanSequence &ss)
+			  { return ss.scanInt64(); });
+		bench("scanIntChecked", text, [](ScanSequence &ss)
+			  {
+			int value = 0;
+			ss.scanIntChecked(value);
+			return value; });
+	}
+	return 0;
+}
@@ -71,14 +71,11 @@ void visualise_robots(const vector<Robot> &robots)
 
 vector<Robot> parse_robots(const string &file)
 {
-    ifstream input(file);
-    ScanSequence ss(input);
-    input.close();
+    ScanSequence ss(file, true);
 
-    vector<Robot> robots;
-
-    ss.applyWithDelim('\n', [&robots](ScanSequence &ss)
-                      {
+    // Each robot is an independent line, so parse them in parallel chunks
+    vector<Robot> robots = ss.parseLinesChunked<Robot>([](ScanSequence &ss)
+                                                       {
         ss.consumeString("p=");
         int x = ss.scanInt();
         ss.consumeString(",");
@@ -88,7 +85,7 @@ vector<Robot> parse_robots(const string &file)
         ss.consumeString(",");
         int vY = ss.scanInt();
 
-        robots.push_back({{x, y}, {vX, vY}}); });
+        return Robot{{x, y}, {vX, vY}}; });
 
     return robots;
 }
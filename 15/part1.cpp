@@ -2,7 +2,7 @@
 #include <vector>
 #include <string>
 
-#include "../scanner.h"
+#include "../grid.h"
 
 // #define DEBUG_PRINT_TURNS
 
@@ -34,7 +34,7 @@ private:
         }
     };
 
-    std::vector<std::vector<Cells>> grid;
+    Grid<Cells> grid;
 
     std::vector<char> moves;
 
@@ -42,7 +42,7 @@ private:
 
     Cells at(const Pos &pos)
     {
-        return grid[pos.y][pos.x];
+        return grid.at(pos.y, pos.x);
     }
 
     Cells
@@ -65,21 +65,8 @@ private:
     }
     void parseGrid(ScanSequence &ss)
     {
-        grid.clear();
-        int y = 0;
-        int x;
-        while (ss.peekAtChar() == '#')
-        {
-            grid.push_back({});
-            x = 0;
-            while (ss.peekAtChar() != '\n')
-            {
-                grid.back().push_back(parseCell(ss.scanChar(), x, y));
-                x++;
-            }
-            ss.consumeWhitespace();
-            y++;
-        }
+        grid = Grid<Cells>::load(ss, [this](char c, int y, int x)
+                                 { return parseCell(c, x, y); });
     }
 
     bool shuffleBoxes(const Pos &cur, const Pos &dir)
@@ -94,8 +81,8 @@ private:
         {
             // std::cout << "End shuffle starting at " << cur.x << "," << cur.y << std::endl;
             // the ideal situation, delete the first box and add one in at the empty
-            grid[next.y][next.x] = BOX;
-            grid[cur.y][cur.x] = EMPTY;
+            grid.at(next.y, next.x) = BOX;
+            grid.at(cur.y, cur.x) = EMPTY;
             return true;
         }
 
@@ -131,27 +118,26 @@ private:
 public:
     Warehouse(const std::string &input)
     {
-        std::ifstream file(input);
-        ScanSequence ss(file);
+        ScanSequence ss(input, true);
 
         parseGrid(ss);
         ss.consumeWhitespace();
 
         while (!ss.isAtEnd())
         {
-            moves.push_back(ss.scanChar());
+            char move = ss.scanChar();
+            if (move != '\n')
+                moves.push_back(move);
         }
-
-        file.close();
     }
 
     void printGrid(bool printMoves)
     {
-        for (int y = 0; y < grid.size(); y++)
+        for (int y = 0; y < grid.numRows(); y++)
         {
-            for (int x = 0; x < grid[y].size(); x++)
+            for (int x = 0; x < grid.numCols(); x++)
             {
-                switch (grid[y][x])
+                switch (grid.at(y, x))
                 {
                 case WALL:
                     std::cout << '#';
@@ -190,11 +176,11 @@ public:
     int sumCoords()
     {
         int sum = 0;
-        for (int y = 0; y < grid.size(); y++)
+        for (int y = 0; y < grid.numRows(); y++)
         {
-            for (int x = 0; x < grid[y].size(); x++)
+            for (int x = 0; x < grid.numCols(); x++)
             {
-                if (grid[y][x] == BOX)
+                if (grid.at(y, x) == BOX)
                 {
                     sum += (100 * y) + x;
                 }
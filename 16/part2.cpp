@@ -1,4 +1,4 @@
-#include "../scanner.h"
+#include "../grid.h"
 
 #include <iostream>
 #include <fstream>
@@ -50,7 +50,7 @@ struct Reindeer
 class Maze
 {
 private:
-    std::vector<std::vector<Cell>> maze;
+    Grid<Cell> maze;
     Reindeer start;
 
     std::stack<Reindeer> stackDFS;
@@ -59,11 +59,11 @@ private:
 
     Cell &at(const Reindeer &pos)
     {
-        return maze[pos.y][pos.x];
+        return maze.at(pos.y, pos.x);
     }
     Cell &at(const int &x, const int &y)
     {
-        return maze[y][x];
+        return maze.at(y, x);
     }
 
     void printReindeer(const Reindeer &r)
@@ -134,43 +134,27 @@ public:
     Maze(const std::string &file)
     {
         ScanSequence ss("input.txt", true);
-        int y = 0;
-        while (!ss.isAtEnd())
-        {
-            maze.push_back({});
-            int x = 0;
-            while (!ss.isAtEnd() && ss.peekAtChar() != '\n')
+        maze = Grid<Cell>::load(ss, [this](char c, int y, int x)
+                                {
+            switch (c)
             {
-                char c = ss.scanChar();
-                switch (c)
-                {
-                case '#':
-                    maze.back().push_back(WALL);
-                    break;
-                case 'S':
-                    maze.back().push_back(EXPLORED);
-                    start = {x, y, EAST, 0, {}};
-                    break;
-                case 'E':
-                    maze.back().push_back(END);
-                    break;
-                default:
-                    maze.back().push_back(EMPTY);
-                    break;
-                }
-
-                x++;
-            }
-            y++;
-            ss.consumeWhitespace();
-        }
+            case '#':
+                return WALL;
+            case 'S':
+                start = {x, y, EAST, 0, {}};
+                return EXPLORED;
+            case 'E':
+                return END;
+            default:
+                return EMPTY;
+            } });
     }
 
     void printMaze(const Reindeer &cur = {0, 0, NORTH, 0, {}})
     {
-        for (int y = 0; y < maze.size(); y++)
+        for (int y = 0; y < maze.numRows(); y++)
         {
-            for (int x = 0; x < maze[y].size(); x++)
+            for (int x = 0; x < maze.numCols(); x++)
             {
                 if (cur.x == x && cur.y == y)
                 {
@@ -0,0 +1,143 @@
+#ifndef BITPLANES_H
+#define BITPLANES_H
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <string_view>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+
+// A char grid split into one bitplane per letter. Each row of a plane is a run of 64 bit words,
+// with bit (c % 64) of word (c / 64) set where the letter is in column c. Cells that hold a
+// word's letters along any straight line can then be found 64 columns at a time, by ANDing
+// together rows of each letter's plane shifted across by the line's column step.
+class BitPlanes
+{
+private:
+    int rows;
+    int cols;
+    int words;
+
+    // Index into 'planes' for each char, or -1 if the char isn't in the grid
+    std::array<int, 256> planeOf;
+    std::vector<std::vector<uint64_t>> planes;
+
+    // Mask of the columns in use in the last word of each row
+    uint64_t lastWordMask;
+
+    // Word 'w' of 'row' shifted so that bit c holds column c + 'shift' of the row, reading past
+    // either edge of the row as 0
+    uint64_t shiftedWord(const uint64_t *row, int w, int shift) const;
+
+public:
+    BitPlanes();
+    BitPlanes(const Grid<char> &grid);
+
+    int numRows() const { return rows; }
+    int numCols() const { return cols; }
+    int wordsPerRow() const { return words; }
+
+    // Row 'row' of the plane for 'letter', or nullptr if the letter isn't in the grid
+    const uint64_t *planeRow(char letter, int row) const;
+
+    // Set 'out' (wordsPerRow() words) to the columns c of row 'row' where 'word' lies along the
+    // line through (row, c) with step (dRow, dCol), such that word[anchor] is at (row, c).
+    // Returns false, leaving 'out' cleared, if there are no such columns.
+    bool matchRow(std::string_view word, int anchor, int dRow, int dCol, int row, uint64_t *out) const;
+
+    static int popcount(const uint64_t *bits, int words);
+};
+
+inline BitPlanes::BitPlanes() : rows(0), cols(0), words(0), lastWordMask(0)
+{
+    planeOf.fill(-1);
+}
+
+inline BitPlanes::BitPlanes(const Grid<char> &grid)
+    : rows(grid.numRows()), cols(grid.numCols()), words((grid.numCols() + 63) / 64)
+{
+    planeOf.fill(-1);
+    lastWordMask = cols % 64 ? (uint64_t(1) << (cols % 64)) - 1 : ~uint64_t(0);
+
+    for (int r = 0; r < rows; r++)
+    {
+        const char *row = grid.rowData(r);
+        for (int c = 0; c < cols; c++)
+        {
+            int &plane = planeOf[static_cast<unsigned char>(row[c])];
+            if (plane < 0)
+            {
+                plane = planes.size();
+                planes.emplace_back(size_t(rows) * words, 0);
+            }
+            planes[plane][size_t(r) * words + c / 64] |= uint64_t(1) << (c % 64);
+        }
+    }
+}
+
+inline const uint64_t *BitPlanes::planeRow(char letter, int row) const
+{
+    int plane = planeOf[static_cast<unsigned char>(letter)];
+    if (plane < 0)
+        return nullptr;
+    return planes[plane].data() + size_t(row) * words;
+}
+
+inline uint64_t BitPlanes::shiftedWord(const uint64_t *row, int w, int shift) const
+{
+    // Find the source word holding the bit for column 0 of word 'w', rounding down for negative columns
+    int bit = w * 64 + shift;
+    int src = bit >= 0 ? bit / 64 : -((63 - bit) / 64);
+    int offset = bit - src * 64;
+
+    uint64_t lo = src >= 0 && src < words ? row[src] : 0;
+    if (!offset)
+        return lo;
+    uint64_t hi = src + 1 >= 0 && src + 1 < words ? row[src + 1] : 0;
+    return (lo >> offset) | (hi << (64 - offset));
+}
+
+inline bool BitPlanes::matchRow(std::string_view word, int anchor, int dRow, int dCol, int row, uint64_t *out) const
+{
+    for (int w = 0; w < words; w++)
+    {
+        out[w] = w + 1 < words ? ~uint64_t(0) : lastWordMask;
+    }
+
+    for (int i = 0; i < int(word.size()); i++)
+    {
+        int r = row + (i - anchor) * dRow;
+        const uint64_t *source = r >= 0 && r < rows ? planeRow(word[i], r) : nullptr;
+        if (!source)
+        {
+            std::fill(out, out + words, 0);
+            return false;
+        }
+
+        int shift = (i - anchor) * dCol;
+        uint64_t any = 0;
+        for (int w = 0; w < words; w++)
+        {
+            out[w] &= shiftedWord(source, w, shift);
+            any |= out[w];
+        }
+        if (!any)
+            return false;
+    }
+    return true;
+}
+
+inline int BitPlanes::popcount(const uint64_t *bits, int words)
+{
+    int total = 0;
+    for (int w = 0; w < words; w++)
+    {
+        total += __builtin_popcountll(bits[w]);
+    }
+    return total;
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <vector>
+#include <string_view>
+#include <stddef.h>
+
+#include "scanner.h"
+
+// A 2D grid stored contiguously in row-major order, with one allocation for the whole grid.
+// The grid can be surrounded by 'padding' rows and columns of border cells, which at() can
+// read like any other cell. A border of sentinel cells at least as wide as the longest step a
+// search takes means the search never needs a bounds check.
+template <typename T>
+class Grid
+{
+private:
+    std::vector<T> cells;
+    int rows;
+    int cols;
+    int pad;
+    int stride;
+
+    size_t index(int row, int col) const
+    {
+        return size_t(row + pad) * stride + (col + pad);
+    }
+
+public:
+    Grid();
+    Grid(int rows, int cols, const T &fill = T(), int padding = 0, const T &border = T());
+
+    int numRows() const { return rows; }
+    int numCols() const { return cols; }
+    int padding() const { return pad; }
+
+    // True if (row, col) is inside the grid, not counting the border
+    bool inBounds(int row, int col) const
+    {
+        return row >= 0 && row < rows && col >= 0 && col < cols;
+    }
+
+    // Any cell from -padding() up to numRows() + padding() - 1 (and likewise for columns) can be read
+    T &at(int row, int col) { return cells[index(row, col)]; }
+    const T &at(int row, int col) const { return cells[index(row, col)]; }
+
+    // The cells of one row are contiguous, starting from column 0
+    T *rowData(int row) { return &cells[index(row, 0)]; }
+    const T *rowData(int row) const { return &cells[index(row, 0)]; }
+
+    // Call f(row, col) for each orthogonal neighbour of (row, col) that can be read
+    template <typename F>
+    void forEachOrthogonal(int row, int col, F f) const;
+
+    // Call f(row, col) for each of the 8 neighbours of (row, col) that can be read
+    template <typename F>
+    void forEachAdjacent(int row, int col, F f) const;
+
+    // Load a grid with one cell per char and one row per line, up to the first empty line or the
+    // end of the sequence. 'parse(c, row, col)' produces the cell for each char. The grid is sized
+    // from the input before it is filled, and the sequence is left just past the last row.
+    template <typename F>
+    static Grid<T> load(ScanSequence &ss, F parse, int padding = 0, const T &border = T());
+};
+
+template <typename T>
+Grid<T>::Grid() : rows(0), cols(0), pad(0), stride(0)
+{
+}
+
+template <typename T>
+Grid<T>::Grid(int rows, int cols, const T &fill, int padding, const T &border)
+    : rows(rows), cols(cols), pad(padding), stride(cols + 2 * padding)
+{
+    cells.assign(size_t(rows + 2 * pad) * stride, border);
+    for (int r = 0; r < rows; r++)
+    {
+        T *row = rowData(r);
+        for (int c = 0; c < cols; c++)
+        {
+            row[c] = fill;
+        }
+    }
+}
+
+template <typename T>
+template <typename F>
+void Grid<T>::forEachOrthogonal(int row, int col, F f) const
+{
+    const int dirs[4][2] = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+    for (const auto &d : dirs)
+    {
+        int r = row + d[0], c = col + d[1];
+        if (r >= -pad && r < rows + pad && c >= -pad && c < cols + pad)
+            f(r, c);
+    }
+}
+
+template <typename T>
+template <typename F>
+void Grid<T>::forEachAdjacent(int row, int col, F f) const
+{
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            int r = row + dr, c = col + dc;
+            if ((dr || dc) && r >= -pad && r < rows + pad && c >= -pad && c < cols + pad)
+                f(r, c);
+        }
+    }
+}
+
+template <typename T>
+template <typename F>
+Grid<T> Grid<T>::load(ScanSequence &ss, F parse, int padding, const T &border)
+{
+    // Measure the grid first, so it can be allocated once
+    std::string_view rest = ss.remaining();
+    int rows = 0;
+    size_t cols = 0;
+    size_t lineStart = 0;
+    while (lineStart < rest.size() && rest[lineStart] != '\n')
+    {
+        size_t lineEnd = findChar(rest.data() + lineStart, rest.data() + rest.size(), '\n') - rest.data();
+        if (rows == 0)
+            cols = lineEnd - lineStart;
+        rows++;
+        lineStart = lineEnd + 1;
+    }
+
+    Grid<T> grid(rows, cols, border, padding, border);
+    for (int r = 0; r < rows; r++)
+    {
+        std::string_view line = ss.scanString('\n');
+        ss.consumeString('\n');
+        T *row = grid.rowData(r);
+        for (size_t c = 0; c < line.size() && c < cols; c++)
+        {
+            row[c] = parse(line[c], r, int(c));
+        }
+    }
+    return grid;
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef INSTRUCTIONS_H
+#define INSTRUCTIONS_H
+
+#include <array>
+#include <string_view>
+#include <stdexcept>
+#include <stddef.h>
+#include <stdint.h>
+
+// The shape of one instruction, 'name(x,y,...)', with 'arity' comma separated operands
+// that are each a run of between 'minDigits' and 'maxDigits' digits.
+struct InstructionShape
+{
+    std::string_view name;
+    int arity;
+    int minDigits;
+    int maxDigits;
+};
+
+// Most operands any instruction can take
+constexpr int MAX_OPERANDS = 8;
+
+typedef std::array<long long, MAX_OPERANDS> Operands;
+
+// A set of instruction shapes compiled into one automaton over 'name(' for every instruction.
+// Missing transitions are filled in from the Aho-Corasick failure links, so matching a name
+// costs one table lookup per char however many instructions there are. The constructor is
+// constexpr, so a fixed set is compiled along with the program and a bad set fails to compile.
+//
+// Names may not contain digits, '(', ',' or ')', and no name may end with another whole name.
+// Together these mean a failed instruction never hides the start of another one, so the
+// scanner never has to back up.
+template <size_t N, size_t MaxNodes>
+class InstructionSet
+{
+public:
+    static constexpr uint16_t NO_INSTRUCTION = 0xFFFF;
+
+    std::array<InstructionShape, N> shapes{};
+
+    // next[node][c] is the node reached from 'node' on char 'c'. Node 0 is the root
+    std::array<std::array<uint16_t, 256>, MaxNodes> next{};
+
+    // The instruction whose 'name(' ends at each node, if any
+    std::array<uint16_t, MaxNodes> instruction{};
+
+    size_t numNodes = 1;
+
+    constexpr InstructionSet(const InstructionShape (&shapes)[N]);
+
+private:
+    static constexpr bool allowedInName(char c)
+    {
+        return !(c >= '0' && c <= '9') && c != '(' && c != ',' && c != ')';
+    }
+};
+
+template <size_t N, size_t MaxNodes>
+constexpr InstructionSet<N, MaxNodes>::InstructionSet(const InstructionShape (&shapes)[N])
+{
+    for (size_t i = 0; i < MaxNodes; i++)
+    {
+        instruction[i] = NO_INSTRUCTION;
+    }
+
+    // Build a trie over 'name(' for every instruction. Trie edges never lead back to the root,
+    // so a 0 entry means there is no edge yet
+    for (size_t i = 0; i < N; i++)
+    {
+        const InstructionShape &shape = shapes[i];
+        if (shape.name.empty() || shape.arity < 0 || shape.arity > MAX_OPERANDS)
+            throw std::invalid_argument("instruction needs a name and at most MAX_OPERANDS operands");
+        if (shape.minDigits < 1 || shape.minDigits > shape.maxDigits || shape.maxDigits > 18)
+            throw std::invalid_argument("operands need between 1 and 18 digits");
+        this->shapes[i] = shape;
+
+        size_t node = 0;
+        for (size_t j = 0; j <= shape.name.size(); j++)
+        {
+            char c = j < shape.name.size() ? shape.name[j] : '(';
+            if (j < shape.name.size() && !allowedInName(c))
+                throw std::invalid_argument("instruction names can't contain digits, '(', ',' or ')'");
+
+            uint16_t &edge = next[node][static_cast<unsigned char>(c)];
+            if (!edge)
+            {
+                if (numNodes == MaxNodes)
+                    throw std::invalid_argument("too many instruction name chars for MaxNodes");
+                edge = numNodes++;
+            }
+            node = edge;
+        }
+
+        if (instruction[node] != NO_INSTRUCTION)
+            throw std::invalid_argument("instruction names must be unique");
+        instruction[node] = i;
+    }
+
+    // Fill in the missing transitions breadth first, each from the node's failure link
+    std::array<uint16_t, MaxNodes> fail{};
+    std::array<uint16_t, MaxNodes> queue{};
+    size_t head = 0, tail = 0;
+    for (size_t c = 0; c < 256; c++)
+    {
+        if (next[0][c])
+            queue[tail++] = next[0][c];
+    }
+    while (head < tail)
+    {
+        uint16_t node = queue[head++];
+        for (size_t c = 0; c < 256; c++)
+        {
+            uint16_t child = next[node][c];
+            if (child)
+            {
+                fail[child] = next[fail[node]][c];
+                queue[tail++] = child;
+            }
+            else
+            {
+                next[node][c] = next[fail[node]][c];
+            }
+        }
+
+        // A name ending in another name would leave the shorter one unmatched if the longer one failed
+        if (instruction[node] != NO_INSTRUCTION)
+        {
+            for (uint16_t suffix = fail[node]; suffix; suffix = fail[suffix])
+            {
+                if (instruction[suffix] != NO_INSTRUCTION)
+                    throw std::invalid_argument("no instruction name may end with another instruction name");
+            }
+        }
+    }
+}
+
+// Compile a set of instruction shapes, e.g.
+//     constexpr auto set = compileInstructions({{"mul", 2, 1, 3}, {"do", 0, 1, 1}});
+// MaxNodes must be more than the total length of every name, plus one per name.
+template <size_t MaxNodes = 64, size_t N>
+constexpr InstructionSet<N, MaxNodes> compileInstructions(const InstructionShape (&shapes)[N])
+{
+    return InstructionSet<N, MaxNodes>(shapes);
+}
+
+// Streams input through an InstructionSet, calling 'handler(instruction, operands)' for every
+// complete instruction found, where 'instruction' is the index of its shape and 'operands'
+// holds its values in order. Input can be fed in any number of pieces, and instructions split
+// across pieces are still found.
+template <typename Set, typename Handler>
+class InstructionScanner
+{
+private:
+    const Set &set;
+    Handler handler;
+
+    // The automaton node while matching a name
+    uint16_t node;
+
+    // The instruction whose operands are being scanned, if any
+    uint16_t current;
+    int operand;
+    int digits;
+    Operands operands;
+
+    // Advance by one character
+    void step(unsigned char c);
+
+public:
+    InstructionScanner(const Set &set, Handler handler);
+
+    // Scan the next piece of input
+    void feed(const char *begin, const char *end);
+};
+
+template <typename Set, typename Handler>
+InstructionScanner<Set, Handler>::InstructionScanner(const Set &set, Handler handler)
+    : set(set), handler(handler), node(0), current(Set::NO_INSTRUCTION), operand(0), digits(0), operands{}
+{
+}
+
+template <typename Set, typename Handler>
+void InstructionScanner<Set, Handler>::feed(const char *begin, const char *end)
+{
+    for (const char *c = begin; c != end; c++)
+    {
+        step(static_cast<unsigned char>(*c));
+    }
+}
+
+template <typename Set, typename Handler>
+void InstructionScanner<Set, Handler>::step(unsigned char c)
+{
+    if (current == Set::NO_INSTRUCTION)
+    {
+        node = set.next[node][c];
+        if (set.instruction[node] != Set::NO_INSTRUCTION)
+        {
+            current = set.instruction[node];
+            operand = 0;
+            digits = 0;
+            operands[0] = 0;
+            node = 0;
+        }
+        return;
+    }
+
+    const InstructionShape &shape = set.shapes[current];
+    if (operand < shape.arity)
+    {
+        if (c >= '0' && c <= '9' && digits < shape.maxDigits)
+        {
+            operands[operand] = operands[operand] * 10 + (c - '0');
+            digits++;
+            return;
+        }
+        if (digits >= shape.minDigits && c == ',' && operand + 1 < shape.arity)
+        {
+            operand++;
+            operands[operand] = 0;
+            digits = 0;
+            return;
+        }
+    }
+    if (c == ')' && (shape.arity == 0 || (operand + 1 == shape.arity && digits >= shape.minDigits)))
+    {
+        handler(current, operands);
+        current = Set::NO_INSTRUCTION;
+        return;
+    }
+
+    // The instruction failed. Nothing inside it could start another one, so start again from this char
+    current = Set::NO_INSTRUCTION;
+    node = set.next[0][c];
+}
+
+#endif
@@ -2,20 +2,58 @@
 #define SCANNER_H
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <functional>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <exception>
 #include <stdint.h>
+#include <limits>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 class ScanSequence
 {
 
 private:
-    std::string seq;
+    // Backing storage for sequences built from a string or stream.
+    // Sequences opened from a file path are mmapped instead, and scan
+    // directly over the mapping.
+    std::string owned;
+    void *mapped;
+    size_t mappedLen;
+
+    const char *seq;
     size_t len;
     size_t cur;
 
+    void useOwned();
+    void mapFile(const std::string &file);
+
+    // A non-owning sequence over part of another sequence's buffer
+    ScanSequence(const char *begin, const char *end);
+
+    // Accumulate an optionally signed run of digits into T without allocating
+    template <typename T>
+    T scanNumber();
+
+    // As scanNumber, but returns false if there are no digits or the value overflows T
+    template <typename T>
+    bool scanNumberChecked(T &out);
+
     char peek();
 
     bool consume();
@@ -28,22 +66,48 @@ public:
     ScanSequence(std::string str);
     ScanSequence(std::string file, bool openFile);
     ScanSequence(std::ifstream &file);
+    ~ScanSequence();
+
+    // The sequence may point into a mapping it owns, so it can't be copied
+    ScanSequence(const ScanSequence &) = delete;
+    ScanSequence &operator=(const ScanSequence &) = delete;
 
     bool isAtEnd();
 
+    // The next char, without consuming it, or '\0' at the end of the sequence
     char peekAtChar()
     {
-        return peek();
+        return isAtEnd() ? '\0' : peek();
     }
-    // Scan and produce a string, ending with the 'endChar' delimiter
-    std::string scanString(const char &endChar);
+    // The rest of the sequence that hasn't been scanned yet
+    std::string_view remaining() const
+    {
+        return std::string_view(seq + cur, len - cur);
+    }
+    // Scan and produce a string, ending with the 'endChar' delimiter.
+    // The view points into the sequence, so it is only valid while the sequence is alive.
+    std::string_view scanString(const char &endChar);
 
     // Scan past a given 'endChar', producing nothing
     void skipUntilPast(const char &endChar);
 
     // Scan and produce an Int. Ends at any non digit character
     int scanInt();
+    int64_t scanInt64();
+    uint32_t scanUInt();
     uint8_t scanUInt8();
+
+    // Scan an Int, returning false if there are no digits or the value overflows an int.
+    // The whole run of digits is consumed either way. With no digits, at most leading whitespace
+    // and a '-' are consumed, so a parse loop has to stop or skip on false rather than retry forever.
+    bool scanIntChecked(int &out);
+    bool scanInt64Checked(int64_t &out);
+
+    // Scan the rest of the sequence as rows of 'numColumns' whitespace separated Ints.
+    // Returns one vector per column, reserved up front from the remaining byte count. Stops at the
+    // first row that isn't 'numColumns' Ints, leaving the sequence at the start of that row.
+    std::vector<std::vector<int>> scanIntColumns(size_t numColumns);
+    // Consume and produce the next char, or '\0' at the end of the sequence
     char scanChar();
 
     // Consume a given sequence. Returns false if that sequence doesn't exist at the current position.
@@ -51,9 +115,27 @@ public:
     bool consumeString(const char &string);
     bool consumeString(const std::string &string);
 
+    // Consume spaces and line endings, including the '\r' of CRLF line endings
     void consumeWhitespace();
 
     void applyWithDelim(const char &delim, std::function<void(ScanSequence &)> apply);
+    // Calls to 'apply' can be inlined here, unlike through std::function
+    template <typename F>
+    void applyWithDelim(const char &delim, F &&apply);
+
+    // Split the rest of the sequence at newlines into one range per thread, and parse each range
+    // with 'parseChunk', which is given a sequence over just that range and returns one T.
+    // Results are returned in input order. 'threads' defaults to the hardware concurrency,
+    // and small inputs use fewer threads. If 'parseChunk' throws, the first exception in input
+    // order is rethrown once every thread has finished.
+    template <typename T, typename F>
+    std::vector<T> parseChunked(F parseChunk, unsigned threads = 0);
+
+    // As parseChunked, but parse each line with 'parseLine', which is given a sequence over
+    // just that line and returns one T. A trailing '\r' is left out of each line, and empty lines
+    // are skipped. Records are returned in input order.
+    template <typename T, typename F>
+    std::vector<T> parseLinesChunked(F parseLine, unsigned threads = 0);
 };
 
 bool ScanSequence::isAtEnd()
@@ -89,83 +171,326 @@ static bool isDigit(const char &c)
     return (c >= '0' && c <= '9');
 }
 
-ScanSequence::ScanSequence(std::string str) : seq(str)
+// Find the first 'c' in [begin, end), returning end if there isn't one.
+// Compares a full vector of chars at a time where the target supports it.
+static const char *findChar(const char *begin, const char *end, const char c)
+{
+#if defined(__AVX2__)
+    const __m256i needle = _mm256_set1_epi8(c);
+    while (end - begin >= 32)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+        if (mask)
+            return begin + __builtin_ctz(mask);
+        begin += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i needle16 = _mm_set1_epi8(c);
+    while (end - begin >= 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle16));
+        if (mask)
+            return begin + __builtin_ctz(mask);
+        begin += 16;
+    }
+#endif
+    while (begin < end && *begin != c)
+    {
+        begin++;
+    }
+    return begin;
+}
+
+// The number of threads to split 'n' items between. 'threads' defaults to the hardware
+// concurrency, and is cut down so no thread gets fewer than 'minPerThread' items. Each caller
+// picks 'minPerThread' in its own unit (bytes, cells, updates, ...) as the least work that is
+// worth starting a thread for, since below it the thread costs more than it saves.
+static unsigned threadCount(size_t n, size_t minPerThread, unsigned threads = 0)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::min<size_t>(threads, n / minPerThread + 1);
+}
+
+// Split [0, n) into one contiguous range per thread and run f(thread, begin, end) on each range
+// in parallel, with range 0 on the calling thread. An exception escaping a worker thread would
+// terminate the program, so each one is carried back, and the first in range order is rethrown
+// once every thread has finished.
+template <typename F>
+void parallelRanges(size_t n, unsigned threads, F f)
 {
+    std::vector<std::exception_ptr> errors(threads);
+    auto runRange = [&](unsigned t)
+    {
+        try
+        {
+            f(t, n * t / threads, n * (t + 1) / threads);
+        }
+        catch (...)
+        {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+    {
+        workers.emplace_back(runRange, t);
+    }
+    runRange(0);
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    for (auto &error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+void ScanSequence::useOwned()
+{
+    seq = owned.data();
+    len = owned.size();
     cur = 0;
-    len = str.size();
 }
 
-ScanSequence::ScanSequence(std::string file, bool openFile)
+void ScanSequence::mapFile(const std::string &file)
+{
+    useOwned();
+
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            mapped = addr;
+            mappedLen = st.st_size;
+            seq = static_cast<const char *>(addr);
+            len = mappedLen;
+        }
+    }
+    close(fd);
+}
+
+ScanSequence::ScanSequence(std::string str) : owned(std::move(str)), mapped(nullptr), mappedLen(0)
+{
+    useOwned();
+}
+
+ScanSequence::ScanSequence(std::string file, bool openFile) : mapped(nullptr), mappedLen(0)
 {
     if (!openFile)
     {
-        seq = file;
-        cur = 0;
-        len = seq.size();
+        owned = std::move(file);
+        useOwned();
     }
     else
     {
-        std::ifstream i(file);
-        std::stringstream buffer;
-        buffer << i.rdbuf();
-        seq = buffer.str();
-        cur = 0;
-        len = seq.size();
-        i.close();
+        mapFile(file);
     }
 }
 
-ScanSequence::ScanSequence(std::ifstream &file)
+ScanSequence::ScanSequence(std::ifstream &file) : mapped(nullptr), mappedLen(0)
 {
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    seq = buffer.str();
+    // Read from the stream's current position. If the stream can be seeked, size the backing
+    // string up front and read straight into it, rather than through a stringstream
+    std::streampos start = file.tellg();
+    std::streampos end = start;
+    if (start != std::streampos(-1) && file.seekg(0, std::ios::end))
+    {
+        end = file.tellg();
+        file.seekg(start);
+    }
+
+    if (start != std::streampos(-1) && end != std::streampos(-1) && file)
+    {
+        std::streamoff size = end - start;
+        if (size > 0)
+        {
+            owned.resize(size);
+            file.read(&owned[0], size);
+            owned.resize(file.gcount());
+        }
+    }
+    else
+    {
+        // Streams that can't be seeked, like pipes, are read through until they run out
+        file.clear();
+        owned.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    useOwned();
+}
+
+ScanSequence::ScanSequence(const char *begin, const char *end) : mapped(nullptr), mappedLen(0)
+{
+    seq = begin;
+    len = end - begin;
     cur = 0;
-    len = seq.size();
 }
 
-std::string ScanSequence::scanString(const char &endChar)
+ScanSequence::~ScanSequence()
 {
-    std::stringstream ss;
-    while (!isAtEnd() && peek() != endChar)
-    {
-        ss << pop();
-    }
-    return ss.str();
+    if (mapped)
+        munmap(mapped, mappedLen);
+}
+
+std::string_view ScanSequence::scanString(const char &endChar)
+{
+    if (isAtEnd())
+        return {};
+
+    size_t start = cur;
+    cur = findChar(seq + cur, seq + len, endChar) - seq;
+    return std::string_view(seq + start, cur - start);
 }
 
 void ScanSequence::skipUntilPast(const char &endChar)
 {
-    while (!isAtEnd() && peek() != endChar)
+    if (isAtEnd())
+        return;
+
+    cur = findChar(seq + cur, seq + len, endChar) - seq;
+    advance(); // step past the endChar
+}
+
+void ScanSequence::consumeWhitespace()
+{
+    while (!isAtEnd() && (peek() == ' ' || peek() == '\n' || peek() == '\r'))
     {
         advance();
     }
-    advance(); // step past the endChar
 }
 
-void ScanSequence::consumeWhitespace()
+template <typename T>
+T ScanSequence::scanNumber()
 {
-    while (!isAtEnd() && (peek() == ' ' || peek() == '\n'))
+    typedef typename std::make_unsigned<T>::type U;
+
+    consumeWhitespace();
+    bool negative = false;
+    if (std::is_signed<T>::value && !isAtEnd() && peek() == '-')
     {
+        negative = true;
         advance();
     }
+
+    // Accumulate unsigned so wrapping on overflow is defined
+    U val = 0;
+    while (!isAtEnd() && isDigit(peek()))
+    {
+        val = (val * 10) + U(pop() - '0');
+    }
+
+    return T(negative ? U(0) - val : val);
 }
 
 int ScanSequence::scanInt()
 {
-    std::stringstream ss;
+    return scanNumber<int>();
+}
+
+int64_t ScanSequence::scanInt64()
+{
+    return scanNumber<int64_t>();
+}
+
+uint32_t ScanSequence::scanUInt()
+{
+    return scanNumber<uint32_t>();
+}
+
+template <typename T>
+bool ScanSequence::scanNumberChecked(T &out)
+{
+    typedef typename std::make_unsigned<T>::type U;
+
     consumeWhitespace();
+    bool negative = false;
     if (!isAtEnd() && peek() == '-')
     {
-        ss << pop();
+        negative = true;
+        advance();
     }
 
+    // The magnitude of the most negative value is one more than the largest value
+    const U limit = U(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+    U val = 0;
+    bool digits = false;
+    bool overflow = false;
     while (!isAtEnd() && isDigit(peek()))
     {
-        ss << pop();
+        digits = true;
+        U digit = pop() - '0';
+        if (val > (limit - digit) / 10)
+            overflow = true;
+        else
+            val = (val * 10) + digit;
     }
 
-    return stoi(ss.str());
+    if (!digits || overflow)
+        return false;
+
+    out = negative ? T(U(0) - val) : T(val);
+    return true;
+}
+
+bool ScanSequence::scanIntChecked(int &out)
+{
+    return scanNumberChecked<int>(out);
+}
+
+bool ScanSequence::scanInt64Checked(int64_t &out)
+{
+    return scanNumberChecked<int64_t>(out);
+}
+
+std::vector<std::vector<int>> ScanSequence::scanIntColumns(size_t numColumns)
+{
+    std::vector<std::vector<int>> columns(numColumns);
+    consumeWhitespace();
+    if (isAtEnd() || numColumns == 0)
+        return columns;
+
+    // Estimate the row count from the length of the first row
+    size_t firstRow = findChar(seq + cur, seq + len, '\n') - (seq + cur) + 1;
+    size_t estimate = (len - cur) / firstRow + 1;
+    for (auto &column : columns)
+    {
+        column.reserve(estimate);
+    }
+
+    std::vector<int> row(numColumns);
+    while (!isAtEnd())
+    {
+        // Only keep rows that are all numbers, and stop at the first that isn't rather than
+        // filling the columns with zeros
+        size_t rowStart = cur;
+        for (auto &value : row)
+        {
+            if (!scanIntChecked(value))
+            {
+                cur = rowStart;
+                return columns;
+            }
+        }
+        for (size_t i = 0; i < numColumns; i++)
+        {
+            columns[i].push_back(row[i]);
+        }
+        consumeWhitespace();
+    }
+    return columns;
 }
 
 uint8_t ScanSequence::scanUInt8()
@@ -181,12 +506,18 @@ uint8_t ScanSequence::scanUInt8()
 
 char ScanSequence::scanChar()
 {
+    // The sequence may end at the edge of a mapping, or inside a larger buffer, so never read past it
+    if (isAtEnd())
+        return '\0';
     return pop();
 }
 
 bool ScanSequence::consumeString(const char &string)
 {
-    return consumeString(std::string(1, string));
+    if (isAtEnd() || peek() != string)
+        return false;
+    advance();
+    return true;
 }
 bool ScanSequence::consumeString(const std::string &string)
 {
@@ -218,4 +549,312 @@ void ScanSequence::applyWithDelim(const char &delim, std::function<void(ScanSequ
     }
 }
 
+template <typename F>
+void ScanSequence::applyWithDelim(const char &delim, F &&apply)
+{
+    while (!isAtEnd())
+    {
+        apply(*this);
+        if (!consumeString(delim))
+            return;
+    }
+}
+
+template <typename T, typename F>
+std::vector<T> ScanSequence::parseChunked(F parseChunk, unsigned threads)
+{
+    const size_t minChunkBytes = 1 << 16; // bytes
+
+    size_t remaining = len - cur;
+    threads = threadCount(remaining, minChunkBytes, threads);
+
+    // Split evenly by bytes, then move each boundary to just past the next newline
+    const char *end = seq + len;
+    std::vector<const char *> bounds{seq + cur};
+    for (unsigned t = 1; t < threads; t++)
+    {
+        const char *target = std::max(seq + cur + remaining * t / threads, bounds.back());
+        const char *newline = findChar(target, end, '\n');
+        bounds.push_back(newline == end ? end : newline + 1);
+    }
+    bounds.push_back(end);
+
+    // One range per chunk, so each thread parses the chunk between its pair of bounds
+    std::vector<T> results(threads);
+    parallelRanges(threads, threads, [&](unsigned t, size_t, size_t)
+                   {
+        ScanSequence chunk(bounds[t], bounds[t + 1]);
+        results[t] = parseChunk(chunk); });
+    cur = len;
+
+    return results;
+}
+
+template <typename T, typename F>
+std::vector<T> ScanSequence::parseLinesChunked(F parseLine, unsigned threads)
+{
+    auto parseLines = [&parseLine](ScanSequence &chunk)
+    {
+        std::vector<T> records;
+        const char *lineStart = chunk.seq;
+        const char *end = chunk.seq + chunk.len;
+        while (lineStart < end)
+        {
+            const char *lineEnd = findChar(lineStart, end, '\n');
+            // Leave the '\r' of a CRLF line ending out of the line
+            const char *lineStop = lineEnd != lineStart && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+            if (lineStop != lineStart)
+            {
+                ScanSequence line(lineStart, lineStop);
+                records.push_back(parseLine(line));
+            }
+            lineStart = lineEnd + 1;
+        }
+        return records;
+    };
+    std::vector<std::vector<T>> parts = parseChunked<std::vector<T>>(parseLines, threads);
+
+    if (parts.size() == 1)
+        return std::move(parts[0]);
+
+    size_t total = 0;
+    for (const auto &part : parts)
+    {
+        total += part.size();
+    }
+    std::vector<T> records;
+    records.reserve(total);
+    for (auto &part : parts)
+    {
+        std::move(part.begin(), part.end(), std::back_inserter(records));
+    }
+    return records;
+}
+
+// A ScanSequence over a stream that is read in fixed size blocks, so memory use stays
+// constant however large the input is. Tokens may span block boundaries, as the block is
+// only refilled once every char in it has been consumed.
+class StreamScanSequence
+{
+
+private:
+    std::istream &stream;
+    std::vector<char> block;
+    size_t len;
+    size_t cur;
+
+    // Read the next block once the current one is used up. Returns false at the end of the stream
+    bool refill();
+
+    char peek();
+
+    char pop();
+
+    void advance();
+
+    template <typename T>
+    T scanNumber();
+
+public:
+    StreamScanSequence(std::istream &stream, size_t blockSize = 1 << 16);
+
+    // The sequence reads from a stream it doesn't own, so it can't be copied
+    StreamScanSequence(const StreamScanSequence &) = delete;
+    StreamScanSequence &operator=(const StreamScanSequence &) = delete;
+
+    bool isAtEnd();
+
+    // The next char, without consuming it, or '\0' at the end of the stream
+    char peekAtChar()
+    {
+        return isAtEnd() ? '\0' : peek();
+    }
+    // Scan and produce a string, ending with the 'endChar' delimiter
+    std::string scanString(const char &endChar);
+
+    // Scan past a given 'endChar', producing nothing
+    void skipUntilPast(const char &endChar);
+
+    // Scan and produce an Int. Ends at any non digit character
+    int scanInt();
+    int64_t scanInt64();
+    uint32_t scanUInt();
+    uint8_t scanUInt8();
+    // Consume and produce the next char, or '\0' at the end of the stream
+    char scanChar();
+
+    // Consume a given sequence. Returns false if that sequence doesn't exist at the current position.
+    bool consumeString(const char &string);
+    bool consumeString(const std::string &string);
+
+    void consumeWhitespace();
+
+    void applyWithDelim(const char &delim, std::function<void(StreamScanSequence &)> apply);
+    // Calls to 'apply' can be inlined here, unlike through std::function
+    template <typename F>
+    void applyWithDelim(const char &delim, F &&apply);
+};
+
+StreamScanSequence::StreamScanSequence(std::istream &stream, size_t blockSize) : stream(stream), block(blockSize), len(0), cur(0)
+{
+}
+
+bool StreamScanSequence::refill()
+{
+    if (!stream)
+        return false;
+
+    stream.read(block.data(), block.size());
+    len = stream.gcount();
+    cur = 0;
+    return len > 0;
+}
+
+bool StreamScanSequence::isAtEnd()
+{
+    return cur >= len && !refill();
+}
+
+char StreamScanSequence::peek()
+{
+    return block[cur];
+}
+
+char StreamScanSequence::pop()
+{
+    return block[cur++];
+}
+
+void StreamScanSequence::advance()
+{
+    if (isAtEnd())
+        return;
+    cur++;
+}
+
+std::string StreamScanSequence::scanString(const char &endChar)
+{
+    std::string res;
+    while (!isAtEnd())
+    {
+        const char *start = block.data() + cur;
+        const char *found = findChar(start, block.data() + len, endChar);
+        res.append(start, found);
+        cur = found - block.data();
+        if (cur < len)
+            break;
+    }
+    return res;
+}
+
+void StreamScanSequence::skipUntilPast(const char &endChar)
+{
+    while (!isAtEnd())
+    {
+        cur = findChar(block.data() + cur, block.data() + len, endChar) - block.data();
+        if (cur < len)
+            break;
+    }
+    advance(); // step past the endChar
+}
+
+void StreamScanSequence::consumeWhitespace()
+{
+    while (!isAtEnd() && (peek() == ' ' || peek() == '\n' || peek() == '\r'))
+    {
+        advance();
+    }
+}
+
+template <typename T>
+T StreamScanSequence::scanNumber()
+{
+    typedef typename std::make_unsigned<T>::type U;
+
+    consumeWhitespace();
+    bool negative = false;
+    if (std::is_signed<T>::value && !isAtEnd() && peek() == '-')
+    {
+        negative = true;
+        advance();
+    }
+
+    U val = 0;
+    while (!isAtEnd() && isDigit(peek()))
+    {
+        val = (val * 10) + U(pop() - '0');
+    }
+
+    return T(negative ? U(0) - val : val);
+}
+
+int StreamScanSequence::scanInt()
+{
+    return scanNumber<int>();
+}
+
+int64_t StreamScanSequence::scanInt64()
+{
+    return scanNumber<int64_t>();
+}
+
+uint32_t StreamScanSequence::scanUInt()
+{
+    return scanNumber<uint32_t>();
+}
+
+uint8_t StreamScanSequence::scanUInt8()
+{
+    return scanNumber<uint8_t>();
+}
+
+char StreamScanSequence::scanChar()
+{
+    // isAtEnd loads the next block once the current one is used up
+    if (isAtEnd())
+        return '\0';
+    return pop();
+}
+
+bool StreamScanSequence::consumeString(const char &string)
+{
+    if (isAtEnd() || peek() != string)
+        return false;
+    advance();
+    return true;
+}
+bool StreamScanSequence::consumeString(const std::string &string)
+{
+    for (const char &c : string)
+    {
+        if (isAtEnd() || peek() != c)
+        {
+            return false;
+        }
+        advance();
+    }
+    return true;
+}
+
+void StreamScanSequence::applyWithDelim(const char &delim, std::function<void(StreamScanSequence &)> apply)
+{
+    while (!isAtEnd())
+    {
+        apply(*this);
+        if (!consumeString(delim))
+            return;
+    }
+}
+
+template <typename F>
+void StreamScanSequence::applyWithDelim(const char &delim, F &&apply)
+{
+    while (!isAtEnd())
+    {
+        apply(*this);
+        if (!consumeString(delim))
+            return;
+    }
+}
+
 #endif
\ No newline at end of file
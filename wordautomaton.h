@@ -0,0 +1,135 @@
+#ifndef WORDAUTOMATON_H
+#define WORDAUTOMATON_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// An Aho-Corasick automaton over a list of words, for counting how often every word appears in
+// some text in one pass, however many words there are. Missing transitions are filled in from
+// the failure links, so each char of text costs one table lookup.
+//
+// Counting is split in two so passes can be shared out: step() through the text, adding 1 to
+// hits[node] for every node reached, then wordCounts() turns the hits of any number of passes
+// into a count per word.
+class WordAutomaton
+{
+private:
+    // Chars are mapped down to the ones used in the words, with 0 for every other char,
+    // which keeps the transition table small for large word lists
+    std::array<uint8_t, 256> classOf;
+    int numClasses;
+
+    // next[node * numClasses + class] is the node reached from 'node' on a char of that class
+    std::vector<int> next;
+    std::vector<int> fail;
+
+    // Every node in breadth first order, so each node comes after its failure link
+    std::vector<int> order;
+
+    // The node each word ends at, or -1 for an empty word
+    std::vector<int> wordNode;
+
+public:
+    WordAutomaton(const std::vector<std::string> &words);
+
+    int numNodes() const { return fail.size(); }
+    int numWords() const { return wordNode.size(); }
+
+    // The node to start each run of text from
+    static constexpr int ROOT = 0;
+
+    int step(int node, char c) const
+    {
+        return next[size_t(node) * numClasses + classOf[static_cast<unsigned char>(c)]];
+    }
+
+    // The number of matches of each word, given how many times each node was reached
+    std::vector<long long> wordCounts(const std::vector<long long> &hits) const;
+};
+
+inline WordAutomaton::WordAutomaton(const std::vector<std::string> &words)
+{
+    classOf.fill(0);
+    numClasses = 1;
+    for (const std::string &word : words)
+    {
+        for (char c : word)
+        {
+            uint8_t &cls = classOf[static_cast<unsigned char>(c)];
+            if (!cls)
+                cls = numClasses++;
+        }
+    }
+
+    // Build a trie over the words. Trie edges never lead back to the root, so 0 means no edge yet
+    next.assign(numClasses, 0);
+    fail.assign(1, 0);
+    for (const std::string &word : words)
+    {
+        if (word.empty())
+        {
+            wordNode.push_back(-1);
+            continue;
+        }
+
+        int node = ROOT;
+        for (char c : word)
+        {
+            size_t edge = size_t(node) * numClasses + classOf[static_cast<unsigned char>(c)];
+            if (!next[edge])
+            {
+                next[edge] = fail.size();
+                fail.push_back(0);
+                next.resize(next.size() + numClasses, 0);
+            }
+            node = next[edge];
+        }
+        wordNode.push_back(node);
+    }
+
+    // Fill in the missing transitions breadth first, each from the node's failure link.
+    // No word contains a class 0 char, so it always leads back to the root
+    order.reserve(fail.size());
+    order.push_back(ROOT);
+    for (size_t head = 0; head < order.size(); head++)
+    {
+        int node = order[head];
+        for (int cls = 1; cls < numClasses; cls++)
+        {
+            int &child = next[size_t(node) * numClasses + cls];
+            if (child)
+            {
+                fail[child] = node == ROOT ? ROOT : next[size_t(fail[node]) * numClasses + cls];
+                order.push_back(child);
+            }
+            else if (node != ROOT)
+            {
+                child = next[size_t(fail[node]) * numClasses + cls];
+            }
+        }
+    }
+}
+
+inline std::vector<long long> WordAutomaton::wordCounts(const std::vector<long long> &hits) const
+{
+    // Reaching a node also matches every word ending at a node down its chain of failure links,
+    // so push the hits down the chains, deepest nodes first
+    std::vector<long long> total(hits);
+    for (size_t i = order.size() - 1; i > 0; i--)
+    {
+        total[fail[order[i]]] += total[order[i]];
+    }
+
+    std::vector<long long> counts(wordNode.size(), 0);
+    for (size_t i = 0; i < wordNode.size(); i++)
+    {
+        if (wordNode[i] >= 0)
+            counts[i] = total[wordNode[i]];
+    }
+    return counts;
+}
+
+#endif